@@ -52,6 +52,18 @@
           'target_name': 'pty',
           'sources': [
             'src/unix/pty.cc',
+            'src/unix/channel.cc',
+            'src/unix/channel_wrap.cc',
+            'src/unix/compressor.cc',
+            'src/unix/env_block.cc',
+            'src/unix/fd_writer.cc',
+            'src/unix/io_thread.cc',
+            'src/unix/matcher.cc',
+            'src/unix/plain_text.cc',
+            'src/unix/reaper.cc',
+            'src/unix/recorder.cc',
+            'src/unix/scrollback.cc',
+            'src/unix/zygote.cc',
           ],
           'libraries': [
             '-lutil'
@@ -70,6 +82,21 @@
         }
       ]
     }],
+    ['OS=="linux"', {
+      'targets': [
+        {
+          'target_name': 'spawn-zygote',
+          'type': 'executable',
+          'sources': [
+            'src/unix/spawn-zygote.cc',
+          ],
+          'libraries': [
+            '-lutil'
+          ],
+          'cflags': ['-Wall'],
+        },
+      ]
+    }],
     ['OS=="mac"', {
       'targets': [
         {
@@ -43,7 +43,7 @@ fs.writeFileSync(
 );
 
 for (const file of fs.readdirSync(RELEASE)) {
-  if (file.endsWith(".node") || file.endsWith(".pdb") || file === "spawn-helper") {
+  if (file.endsWith(".node") || file.endsWith(".pdb") || file === "spawn-helper" || file === "spawn-zygote") {
     fs.copyFileSync(
       path.join(RELEASE, file),
       path.join(DIST, file)
@@ -54,7 +54,7 @@ const artifactDirs = fs.readdirSync(ARTIFACTS).map((dir) => path.join(ARTIFACTS,
 
 for (const dir of artifactDirs) {
   for (const file of fs.readdirSync(dir)) {
-    if (file.endsWith(".node") || file.endsWith(".pdb") || file === "spawn-helper") {
+    if (file.endsWith(".node") || file.endsWith(".pdb") || file === "spawn-helper" || file === "spawn-zygote") {
       // At least on macOS, the files need to be executable, but that’s lost when
       // downloading them from GitHub Actions:
       // https://github.com/actions/upload-artifact#permission-loss
@@ -36,6 +36,10 @@ export class EventEmitter2<T> {
     return this._event;
   }
 
+  public get hasListeners(): boolean {
+    return this._listeners.length > 0;
+  }
+
   public fire(data: T): void {
     const queue: IListener<T>[] = [];
     for (let i = 0; i < this._listeners.length; i++) {
@@ -4,7 +4,7 @@
  * Copyright (c) 2018, Microsoft Corporation (MIT License).
  */
 
-import { ITerminal, IPtyOpenOptions, IPtyForkOptions, IWindowsPtyForkOptions } from './interfaces';
+import { IEnvBlock, IForegroundProcess, IForkSpec, IProcessEnv, ITerminal, IPtyHandle, IPtyOpenOptions, IPtyForkOptions, IWindowsPtyForkOptions } from './interfaces';
 import { ArgvOrCommandLine } from './types';
 
 let terminalCtor: any;
@@ -30,6 +30,22 @@ export function spawn(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOpt
   return new terminalCtor(file, args, opt);
 }
 
+/**
+ * Like `spawn`, but starts the process without blocking the event loop. Resolves once the process
+ * is running.
+ */
+export function spawnAsync(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions | IWindowsPtyForkOptions): Promise<ITerminal> {
+  return terminalCtor.spawnAsync(file, args, opt);
+}
+
+/**
+ * Spawns a process for each spec in a single native call, specs with the same `env` option share
+ * one parsed copy of it. Returns the terminal of each spec, or the Error it failed with.
+ */
+export function forkMany(specs: IForkSpec[]): Array<ITerminal | Error> {
+  return terminalCtor.forkMany(specs);
+}
+
 /** @deprecated */
 export function fork(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions | IWindowsPtyForkOptions): ITerminal {
   return new terminalCtor(file, args, opt);
@@ -43,3 +59,34 @@ export function createTerminal(file?: string, args?: ArgvOrCommandLine, opt?: IP
 export function open(options: IPtyOpenOptions): ITerminal {
   return terminalCtor.open(options);
 }
+
+/**
+ * Copies and parses an environment once so that it can be passed to many spawns with the
+ * `envBlock` option.
+ */
+export function createEnvBlock(env?: IProcessEnv): IEnvBlock {
+  return terminalCtor.createEnvBlock(env);
+}
+
+export function startZygote(): void {
+  terminalCtor.startZygote();
+}
+
+/**
+ * Takes over a pty handed over with `transfer`, usually by another thread.
+ */
+export function adopt(handle: IPtyHandle, options?: IPtyForkOptions): ITerminal {
+  return terminalCtor.adopt(handle, options);
+}
+
+/**
+ * Queries the foreground process of every terminal in a single native call, off the event loop.
+ * Resolves with null for terminals without one, such as those that exited.
+ */
+export function processMany(terminals: ITerminal[]): Promise<Array<IForegroundProcess | null>> {
+  return terminalCtor.processMany(terminals);
+}
+
+export function setIoThreadPoolSize(size: number): void {
+  terminalCtor.setIoThreadPoolSize(size);
+}
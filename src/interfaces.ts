@@ -3,6 +3,8 @@
  * Copyright (c) 2018, Microsoft Corporation (MIT License).
  */
 
+import { ArgvOrCommandLine } from './types';
+
 export interface IProcessEnv {
   [key: string]: string | undefined;
 }
@@ -115,12 +117,70 @@ interface IBasePtyForkOptions {
 export interface IPtyForkOptions extends IBasePtyForkOptions {
   uid?: number;
   gid?: number;
+  useNativeIo?: boolean;
+  useIoThread?: boolean;
+  scrollbackSize?: number;
+  outputFlushInterval?: number;
+  outputFlushSize?: number;
+  outputBufferPoolSize?: number;
+  flowControlHighWatermark?: number;
+  flowControlLowWatermark?: number;
+  spawnMethod?: 'default' | 'forkpty' | 'zygote';
+  envBlock?: IEnvBlock;
 }
 
 export interface IWindowsPtyForkOptions extends IBasePtyForkOptions {
   conptyInheritCursor?: boolean;
 }
 
+export interface IEnvBlock {
+  readonly env: IProcessEnv;
+}
+
+export interface IForkSpec {
+  file?: string;
+  args?: ArgvOrCommandLine;
+  options?: IPtyForkOptions | IWindowsPtyForkOptions;
+}
+
+export interface IPtyHandle {
+  readonly fd: number;
+  readonly pid: number;
+  readonly pty: string;
+  readonly file: string;
+  readonly name: string;
+  readonly cols: number;
+  readonly rows: number;
+}
+
+export interface IForegroundProcess {
+  readonly pgrp: number;
+  readonly name: string;
+  readonly argv: string[];
+}
+
+export interface ISnapshot {
+  offset: number;
+  data: string | Buffer;
+}
+
+export interface IPasteOptions {
+  bracketed?: boolean;
+  chunkSize?: number;
+  onProgress?: (bytesWritten: number, totalBytes: number | undefined) => void;
+}
+
+export interface ICompressedFrame {
+  data: Buffer;
+  offset: number;
+  length: number;
+}
+
+export interface IRecordingOptions {
+  format?: 'asciicast' | 'raw';
+  input?: boolean;
+}
+
 export interface IPtyOpenOptions {
   cols?: number;
   rows?: number;
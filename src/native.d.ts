@@ -11,10 +11,87 @@ interface IConptyNative {
 }
 
 interface IUnixNative {
-  fork(file: string, args: string[], parsedEnv: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string, onExitCallback: (code: number, signal: number) => void): IUnixProcess;
+  fork(file: string, args: string[], env: string[] | IUnixNativeEnvBlock, envOverrides: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string, spawnMethod: string, onExitCallback: (code: number, signal: number) => void): IUnixProcess;
+  forkAsync(file: string, args: string[], env: string[] | IUnixNativeEnvBlock, envOverrides: string[], cwd: string, cols: number, rows: number, uid: number, gid: number, useUtf8: boolean, helperPath: string, spawnMethod: string, onExitCallback: (code: number, signal: number) => void): Promise<IUnixProcess>;
+  forkMany(parsedEnvs: Array<string[] | IUnixNativeEnvBlock>, specs: IUnixForkSpec[]): Array<IUnixProcess | IUnixForkError>;
+  startZygote(zygotePath: string): void;
   open(cols: number, rows: number): IUnixOpenProcess;
-  process(fd: number, pty?: string): string;
+  process(fd: number): string;
+  /** Drops what `process` and `processMany` keep for the pty, call it before the fd is closed. */
+  forgetProcess(fd: number): void;
+  /** Resolves with the foreground process of each fd, null where there is none. */
+  processMany(fds: number[]): Promise<Array<IUnixForegroundProcess | null>>;
+  /** Returns the foreground process group of the pty, -1 if there is none. */
+  foregroundGroup(fd: number): number;
   resize(fd: number, cols: number, rows: number): void;
+  /** Opens the slave for `inputQueue`, it must be closed once the child exited. */
+  openSlave(tty: string): number;
+  inputQueue(slaveFd: number): number;
+  setIoThreadPoolSize(size: number): void;
+  /** Returns a copy of `fd` to hand to `adopt` on another thread. */
+  detach(fd: number, pid: number): number;
+  adopt(pid: number, onExitCallback: (code: number, signal: number) => void): void;
+  Channel: IUnixChannelConstructor;
+  EnvBlock: IUnixNativeEnvBlockConstructor;
+}
+
+interface IUnixForegroundProcess {
+  pgrp: number;
+  name: string;
+  argv: string[];
+}
+
+interface IUnixNativeEnvBlockConstructor {
+  new(parsedEnv: string[]): IUnixNativeEnvBlock;
+}
+
+/**
+ * Opaque, the parsed environment held in native memory.
+ */
+interface IUnixNativeEnvBlock {
+}
+
+interface IUnixChannelConstructor {
+  /**
+   * `onData` receives either a copy of the output, the output decoded into a string with `utf8`, or
+   * the index of the `pool` buffer it was read into, `length` is the number of bytes and `offset`
+   * the number of bytes of output before them.
+   */
+  new(fd: number, options: IUnixChannelOptions, onData: (data: Buffer | string | number, length: number, offset: number) => void, onEnd: (errorCode?: string) => void, onDrain: () => void): IUnixChannel;
+}
+
+interface IUnixChannelOptions {
+  flushInterval?: number;
+  flushSize?: number;
+  highWatermark?: number;
+  lowWatermark?: number;
+  utf8?: boolean;
+  thread?: boolean;
+  scrollback?: number;
+  pool?: ArrayBuffer[];
+}
+
+interface IUnixChannel {
+  pause(): void;
+  resume(): void;
+  /** Returns the number of bytes queued. */
+  write(data: Buffer): number;
+  queuedBytes(): number;
+  ack(length?: number): void;
+  release(index: number): void;
+  snapshot(offset?: number): { offset: number, data: Buffer | string };
+  /** `matches` alternates the index of a pattern and the offset of its first byte. */
+  match(patterns: Buffer[], onMatch: (matches: number[]) => void): void;
+  /** Passes the output without escape sequences to `target`, or writes it to `target` if it is an fd. */
+  plain(target?: number | ((text: Buffer | string) => void)): void;
+  /** Records to a new file at `path`, stops recording without arguments. */
+  record(path?: string, options?: { format?: string, input?: boolean, cols: number, rows: number }): void;
+  recordResize(cols: number, rows: number): void;
+  /** Passes deflated frames of the output to `target`, or writes them to `target` as gzip if it is an fd. */
+  compress(target?: number | ((frame: Buffer, offset: number, length: number) => void), level?: number): void;
+  /** Stops reading and relays between the pty and `targetFd` on an I/O thread until either closes. */
+  forward(targetFd: number, onEnd: (errorCode?: string) => void): void;
+  close(): void;
 }
 
 interface IConptyProcess {
@@ -24,6 +101,30 @@ interface IConptyProcess {
   conout: string;
 }
 
+/**
+ * The arguments of `fork` for one process of `forkMany`, `env` is an index into its `parsedEnvs`
+ * that `envOverrides` are merged into.
+ */
+interface IUnixForkSpec {
+  file: string;
+  args: string[];
+  env: number;
+  envOverrides: string[];
+  cwd: string;
+  cols: number;
+  rows: number;
+  uid: number;
+  gid: number;
+  utf8: boolean;
+  helperPath: string;
+  spawnMethod: string;
+  onexit: (code: number, signal: number) => void;
+}
+
+interface IUnixForkError {
+  error: string;
+}
+
 interface IUnixProcess {
   fd: number;
   pid: number;
@@ -8,7 +8,7 @@ import { Socket } from 'net';
 import { EventEmitter } from 'events';
 import { ITerminal, IPtyForkOptions, IProcessEnv } from './interfaces';
 import { EventEmitter2, IEvent } from './eventEmitter2';
-import { IExitEvent } from './types';
+import { IExitEvent, IMatchEvent, IOutputEvent, IProcessChangeEvent } from './types';
 
 export const DEFAULT_COLS: number = 80;
 export const DEFAULT_ROWS: number = 24;
@@ -21,6 +21,12 @@ export const DEFAULT_ROWS: number = 24;
 const FLOW_CONTROL_PAUSE =  '\x13';   // defaults to XOFF
 const FLOW_CONTROL_RESUME = '\x11';   // defaults to XON
 
+/**
+ * How often the foreground process group is checked while `onProcessChange` has listeners, for
+ * changes that cause no output.
+ */
+const PROCESS_CHANGE_POLL_INTERVAL_MS = 250;
+
 export abstract class Terminal implements ITerminal {
   protected _socket!: Socket; // HACK: This is unsafe
   protected _pid: number = 0;
@@ -44,6 +50,23 @@ export abstract class Terminal implements ITerminal {
   public get onData(): IEvent<string> { return this._onData.event; }
   private _onExit = new EventEmitter2<IExitEvent>();
   public get onExit(): IEvent<IExitEvent> { return this._onExit.event; }
+  private _onOutput = new EventEmitter2<IOutputEvent>();
+  public get onOutput(): IEvent<IOutputEvent> { return this._onOutput.event; }
+  // Bytes of output emitted so far, for readers that do not count them natively
+  // Undefined once output was decoded before it got here
+  private _outputBytes: number | undefined = 0;
+  private _onProcessChange = new EventEmitter2<IProcessChangeEvent>();
+  public get onProcessChange(): IEvent<IProcessChangeEvent> {
+    return listener => {
+      const disposable = this._onProcessChange.event(listener);
+      this._pollForegroundGroup();
+      return disposable;
+    };
+  }
+  private _foregroundGroup: number | undefined;
+  private _foregroundGroupTimer: NodeJS.Timeout | undefined;
+  private _onMatch = new EventEmitter2<IMatchEvent>();
+  public get onMatch(): IEvent<IMatchEvent> { return this._onMatch.event; }
 
   public get pid(): number { return this._pid; }
   public get cols(): number { return this._cols; }
@@ -93,8 +116,73 @@ export abstract class Terminal implements ITerminal {
   }
 
   protected _forwardEvents(): void {
-    this.on('data', e => this._onData.fire(e));
+    this.on('data', e => {
+      // A new foreground process usually writes right away, as does the shell taking over again.
+      // Checking on output is cheap and only done while someone listens.
+      if (this._onProcessChange.hasListeners) {
+        this._checkForegroundGroup();
+      }
+      const offset = this._outputOffset(e);
+      this._onData.fire(e);
+      if (offset !== undefined) {
+        this._onOutput.fire({ data: e, offset });
+      }
+    });
     this.on('exit', (exitCode, signal) => this._onExit.fire({ exitCode, signal }));
+    this.on('match', (pattern, offset) => this._onMatch.fire({ pattern, offset }));
+    // Only changes after the spawn are reported
+    this._foregroundGroup = this._getForegroundGroup();
+    if (this._onProcessChange.hasListeners) {
+      this._pollForegroundGroup();
+    }
+  }
+
+  private _pollForegroundGroup(): void {
+    if (this._foregroundGroupTimer || !this._readable || this._getForegroundGroup() === undefined) {
+      return;
+    }
+    this._foregroundGroupTimer = setInterval(() => {
+      if (!this._onProcessChange.hasListeners || !this._readable) {
+        clearInterval(this._foregroundGroupTimer!);
+        this._foregroundGroupTimer = undefined;
+        return;
+      }
+      this._checkForegroundGroup();
+    }, PROCESS_CHANGE_POLL_INTERVAL_MS);
+    // Listening must not keep the process alive
+    this._foregroundGroupTimer.unref();
+  }
+
+  private _checkForegroundGroup(): void {
+    const pgrp = this._getForegroundGroup();
+    if (pgrp === undefined || pgrp === this._foregroundGroup) {
+      return;
+    }
+    this._foregroundGroup = pgrp;
+    this._onProcessChange.fire({ pgrp, process: this.process });
+  }
+
+  /**
+   * Returns the foreground process group of the pty, undefined where that is not known.
+   */
+  protected _getForegroundGroup(): number | undefined {
+    return undefined;
+  }
+
+  /**
+   * Returns the byte offset of `data`, the output emitted by the current data event. Only raw
+   * output can be counted, measuring decoded text drifts from the bytes of the pty as soon as the
+   * encoding is not UTF-8 or invalid input was replaced. Returns undefined from the first decoded
+   * chunk on.
+   */
+  protected _outputOffset(data: string | Buffer): number | undefined {
+    if (this._outputBytes === undefined || typeof data === 'string') {
+      this._outputBytes = undefined;
+      return undefined;
+    }
+    const offset = this._outputBytes;
+    this._outputBytes += data.length;
+    return offset;
   }
 
   protected _checkType<T>(name: string, value: T | undefined, type: string, allowArray: boolean = false): void {
@@ -188,6 +276,10 @@ export abstract class Terminal implements ITerminal {
   public abstract get slave(): Socket | undefined;
 
   protected _close(): void {
+    if (this._foregroundGroupTimer) {
+      clearInterval(this._foregroundGroupTimer);
+      this._foregroundGroupTimer = undefined;
+    }
     this._socket.readable = false;
     this.write = () => {};
     this.end = () => {};
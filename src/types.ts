@@ -10,6 +10,24 @@ export interface IExitEvent {
   signal: number | undefined;
 }
 
+export interface IOutputEvent {
+  data: string | Buffer;
+  // The byte offset of the first byte of data in all output of the pty
+  offset: number;
+}
+
+export interface IMatchEvent {
+  // The index of the pattern
+  pattern: number;
+  // The byte offset of the first byte of the match in all output of the pty
+  offset: number;
+}
+
+export interface IProcessChangeEvent {
+  pgrp: number;
+  process: string;
+}
+
 export interface IDisposable {
   dispose(): void;
 }
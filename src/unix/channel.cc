@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * channel.cc:
+ *   Native read/write loop for a pty master fd.
+ */
+
+#include "channel.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+namespace channel {
+
+// Smallest amount of free buffer space offered to a single read(2).
+static const size_t kMinReadSize = 4096;
+
+// Writes up to this size are appended to the last queued chunk.
+static const size_t kMergeWriteSize = 4096;
+
+// Chunks passed to a single writev(2).
+static const int kMaxWriteChunks = 64;
+
+size_t CompleteUtf8Length(const char *data, size_t length) {
+  size_t lead = length;
+  while (lead > 0 && length - lead < 3 && (data[lead - 1] & 0xC0) == 0x80) {
+    lead--;
+  }
+  if (lead == 0) {
+    return length;
+  }
+  lead--;
+  unsigned char byte = data[lead];
+  size_t needed = byte >= 0xF8 ? 1 : byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+  return length - lead < needed ? lead : length;
+}
+
+Channel::Channel(uv_loop_t *loop, int fd, const Options &options, Delegate *delegate)
+    : fd_(fd), options_(options), delegate_(delegate) {
+  if (options_.flush_size == 0) {
+    options_.flush_size = kMinReadSize;
+  }
+  init_error_ = uv_poll_init(loop, &poll_, fd);
+  uv_timer_init(loop, &timer_);
+  // Buffered output alone must not keep the loop alive.
+  uv_unref(reinterpret_cast<uv_handle_t *>(&timer_));
+  poll_.data = this;
+  timer_.data = this;
+  open_handles_ = init_error_ ? 1 : 2;
+}
+
+Channel::~Channel() {
+  close(fd_);
+}
+
+int Channel::Start() {
+  if (init_error_) {
+    return init_error_;
+  }
+  UpdatePoll();
+  return 0;
+}
+
+void Channel::Pause() {
+  paused_ = true;
+  UpdatePoll();
+}
+
+void Channel::Resume() {
+  paused_ = false;
+  UpdatePoll();
+}
+
+size_t Channel::Write(const char *data, size_t length) {
+  if (closed_ || ended_ || length == 0) {
+    return queued_bytes_;
+  }
+  if (!write_queue_.empty() && length <= kMergeWriteSize &&
+      write_queue_.back().size() <= kMergeWriteSize) {
+    write_queue_.back().append(data, length);
+  } else {
+    write_queue_.emplace_back(data, length);
+  }
+  queued_bytes_ += length;
+  UpdatePoll();
+  return queued_bytes_;
+}
+
+void Channel::Ack(size_t length) {
+  unacked_ -= std::min(length, unacked_);
+  if (throttled_ && unacked_ <= options_.low_watermark) {
+    throttled_ = false;
+    UpdatePoll();
+  }
+}
+
+int Channel::AddSlab(char *data, size_t size) {
+  Slab slab = { data, size, false };
+  slabs_.push_back(slab);
+  free_slabs_.push_back(slabs_.size() - 1);
+  return slabs_.size() - 1;
+}
+
+void Channel::ReleaseSlab(int slab) {
+  if (slab < 0 || static_cast<size_t>(slab) >= slabs_.size() || !slabs_[slab].leased) {
+    return;
+  }
+  slabs_[slab].leased = false;
+  free_slabs_.push_back(slab);
+}
+
+void Channel::Close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  delegate_ = nullptr;
+  if (!init_error_) {
+    uv_close(reinterpret_cast<uv_handle_t *>(&poll_), OnHandleClosed);
+  }
+  uv_close(reinterpret_cast<uv_handle_t *>(&timer_), OnHandleClosed);
+}
+
+void Channel::OnHandleClosed(uv_handle_t *handle) {
+  Channel *self = static_cast<Channel *>(handle->data);
+  if (--self->open_handles_ == 0) {
+    delete self;
+  }
+}
+
+void Channel::OnPoll(uv_poll_t *handle, int status, int events) {
+  Channel *self = static_cast<Channel *>(handle->data);
+  if (status < 0) {
+    self->End(-status);
+    return;
+  }
+  if (events & UV_WRITABLE) {
+    self->WritePending();
+  }
+  if (!self->closed_ && (events & UV_READABLE)) {
+    self->ReadAvailable();
+  }
+}
+
+void Channel::OnTimer(uv_timer_t *handle) {
+  Channel *self = static_cast<Channel *>(handle->data);
+  self->timer_active_ = false;
+  self->Flush();
+}
+
+char *Channel::ReserveReadSpace(size_t *space) {
+  // A chunk is read into a single buffer, a free slab is only picked up when
+  // a new chunk starts. Without one output is read into `buffer_` and copied
+  // by the delegate.
+  if (length_ == 0 && slab_ == -1 && !free_slabs_.empty()) {
+    slab_ = free_slabs_.back();
+    free_slabs_.pop_back();
+  }
+  if (slab_ != -1) {
+    *space = slabs_[slab_].size - length_;
+    return slabs_[slab_].data + length_;
+  }
+  if (buffer_.size() - length_ < kMinReadSize) {
+    size_t size = std::max(buffer_.size() * 2, kMinReadSize);
+    buffer_.resize(std::min(size, options_.flush_size + kMinReadSize));
+  }
+  *space = buffer_.size() - length_;
+  return buffer_.data() + length_;
+}
+
+void Channel::ReadAvailable() {
+  // Read until the fd would block or a full chunk is buffered. Anything left
+  // in the fd is picked up on the next loop iteration so that one busy pty
+  // cannot starve the loop.
+  while (length_ < options_.flush_size) {
+    size_t space;
+    char *target = ReserveReadSpace(&space);
+    ssize_t n = read(fd_, target, space);
+    if (n > 0) {
+      length_ += n;
+      continue;
+    }
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    // EIO is how Linux reports that the last slave fd was closed.
+    End(n == 0 || errno == EIO ? 0 : errno);
+    return;
+  }
+
+  if (length_ >= options_.flush_size || options_.flush_interval == 0) {
+    Flush();
+  } else if (length_ > 0 && !timer_active_) {
+    timer_active_ = true;
+    uv_timer_start(&timer_, OnTimer, options_.flush_interval, 0);
+  }
+}
+
+void Channel::WritePending() {
+  while (!write_queue_.empty()) {
+    struct iovec iov[kMaxWriteChunks];
+    int count = 0;
+    for (auto it = write_queue_.begin(); it != write_queue_.end() && count < kMaxWriteChunks; ++it, ++count) {
+      size_t offset = count == 0 ? write_offset_ : 0;
+      iov[count].iov_base = const_cast<char *>(it->data()) + offset;
+      iov[count].iov_len = it->size() - offset;
+    }
+    ssize_t n = writev(fd_, iov, count);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        // The child is gone, the read side reports the end.
+        ClearWrites();
+      }
+      break;
+    }
+    queued_bytes_ -= n;
+    size_t written = n;
+    while (written > 0) {
+      size_t left = write_queue_.front().size() - write_offset_;
+      if (written < left) {
+        write_offset_ += written;
+        break;
+      }
+      written -= left;
+      write_queue_.pop_front();
+      write_offset_ = 0;
+    }
+  }
+  UpdatePoll();
+  if (write_queue_.empty() && delegate_) {
+    delegate_->OnDrain();
+  }
+}
+
+void Channel::ClearWrites() {
+  write_queue_.clear();
+  write_offset_ = 0;
+  queued_bytes_ = 0;
+}
+
+void Channel::Flush() {
+  if (timer_active_) {
+    timer_active_ = false;
+    uv_timer_stop(&timer_);
+  }
+  if (length_ == 0 || !delegate_) {
+    return;
+  }
+  size_t length = length_;
+  int slab = slab_;
+  char *data = slab == -1 ? buffer_.data() : slabs_[slab].data;
+  // An incomplete sequence at the end is carried over to the next chunk.
+  char tail[3];
+  size_t tail_length = 0;
+  if (options_.utf8 && !ended_) {
+    size_t complete = CompleteUtf8Length(data, length);
+    if (complete == 0) {
+      // Nothing but the start of a sequence, wait for the rest of it.
+      return;
+    }
+    tail_length = length - complete;
+    memcpy(tail, data + complete, tail_length);
+    length = complete;
+  }
+  length_ = 0;
+  slab_ = -1;
+  if (options_.high_watermark) {
+    unacked_ += length;
+    if (unacked_ >= options_.high_watermark) {
+      // The delegate may acknowledge right away, stop before handing it over.
+      throttled_ = true;
+      UpdatePoll();
+    }
+  }
+  if (slab != -1) {
+    slabs_[slab].leased = true;
+  }
+  delegate_->OnData(data, length, slab);
+  if (tail_length > 0) {
+    if (buffer_.size() < kMinReadSize) {
+      buffer_.resize(kMinReadSize);
+    }
+    memcpy(buffer_.data(), tail, tail_length);
+    length_ = tail_length;
+  }
+}
+
+void Channel::End(int error) {
+  if (ended_) {
+    return;
+  }
+  ended_ = true;
+  bool dropped_writes = !write_queue_.empty();
+  ClearWrites();
+  UpdatePoll();
+  Flush();
+  if (dropped_writes && delegate_) {
+    delegate_->OnDrain();
+  }
+  if (delegate_) {
+    delegate_->OnEnd(error);
+  }
+}
+
+void Channel::UpdatePoll() {
+  if (closed_ || init_error_) {
+    return;
+  }
+  int events = 0;
+  if (!ended_ && !paused_ && !throttled_) {
+    events |= UV_READABLE;
+  }
+  if (!ended_ && !write_queue_.empty()) {
+    events |= UV_WRITABLE;
+  }
+  if (events == poll_events_) {
+    return;
+  }
+  poll_events_ = events;
+  if (events) {
+    uv_poll_start(&poll_, events, OnPoll);
+  } else {
+    uv_poll_stop(&poll_);
+  }
+}
+
+}  // namespace channel
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * channel.h:
+ *   Native read/write loop for a pty master fd.
+ */
+
+#ifndef NODE_PTY_CHANNEL_H_
+#define NODE_PTY_CHANNEL_H_
+
+#include <uv.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace channel {
+
+struct Options {
+  // Maximum time output is held back before it is handed to the delegate. 0
+  // hands it over after every wakeup.
+  uint64_t flush_interval = 5;
+  // Amount of buffered output that forces a flush regardless of the interval.
+  size_t flush_size = 65536;
+  // Amount of output handed to the delegate but not yet acknowledged with
+  // Ack() at which the fd is no longer read, so that a runaway child blocks on
+  // the full pty instead of output piling up in memory. Reading resumes once
+  // no more than `low_watermark` bytes are unacknowledged. 0 disables this.
+  size_t high_watermark = 0;
+  size_t low_watermark = 0;
+  // Only cut output at UTF-8 code point boundaries. An incomplete sequence at
+  // the end of a chunk is held back and handed over with the next one, so
+  // that every chunk can be decoded on its own.
+  bool utf8 = false;
+};
+
+// Returns the length of `data` without an incomplete UTF-8 sequence at its
+// end. Only the last sequence is looked at, invalid input is left to the
+// decoder.
+size_t CompleteUtf8Length(const char *data, size_t length);
+
+/**
+ * Drains a nonblocking pty master fd from a libuv loop into a growable buffer
+ * and hands the output to its delegate in coalesced chunks, one per
+ * `flush_interval` or `flush_size`, whichever comes first.
+ *
+ * A channel owns its fd. It must only be used from the thread running its
+ * loop and deletes itself once closed.
+ */
+class Channel {
+ public:
+  class Delegate {
+   public:
+    virtual ~Delegate() {}
+    // Called with the coalesced output. If `slab` is -1 the data is only valid
+    // during the call, otherwise it was read straight into that pool slab
+    // which stays leased until it is released.
+    virtual void OnData(const char *data, size_t length, int slab) = 0;
+    // Called once the fd reached EOF or failed, `error` is 0 or an errno. The
+    // usual way for a pty to end is EIO after the last slave fd was closed,
+    // which is reported as 0.
+    virtual void OnEnd(int error) = 0;
+    // Called when the write queue was emptied, either because everything was
+    // written or because the pty ended and the rest was dropped.
+    virtual void OnDrain() = 0;
+  };
+
+  Channel(uv_loop_t *loop, int fd, const Options &options, Delegate *delegate);
+
+  // Starts reading, returns 0 or a libuv error code.
+  int Start();
+  void Pause();
+  void Resume();
+  // Queues `data` and returns the number of bytes queued in total. Nothing is
+  // written right away, everything queued until the fd is next polled goes
+  // out in a single writev(2).
+  size_t Write(const char *data, size_t length);
+  size_t queued_bytes() const { return queued_bytes_; }
+  // Acknowledges that `length` bytes of output were consumed, see
+  // `Options::high_watermark`.
+  void Ack(size_t length);
+  // Adds a buffer of at least `flush_size` bytes to the slab pool and returns
+  // its index. While pool slabs are free, output is read directly into them.
+  int AddSlab(char *data, size_t size);
+  // Hands a slab passed to OnData back to the pool.
+  void ReleaseSlab(int slab);
+  // Stops all I/O and closes the fd. No delegate method is called afterwards.
+  void Close();
+
+ private:
+  ~Channel();
+
+  static void OnPoll(uv_poll_t *handle, int status, int events);
+  static void OnTimer(uv_timer_t *handle);
+  static void OnHandleClosed(uv_handle_t *handle);
+
+  struct Slab {
+    char *data;
+    size_t size;
+    bool leased;
+  };
+
+  char *ReserveReadSpace(size_t *space);
+  void ReadAvailable();
+  void WritePending();
+  void ClearWrites();
+  void Flush();
+  void End(int error);
+  void UpdatePoll();
+
+  uv_poll_t poll_;
+  uv_timer_t timer_;
+  int fd_;
+  Options options_;
+  Delegate *delegate_;
+
+  std::vector<char> buffer_;
+  size_t length_ = 0;
+  std::vector<Slab> slabs_;
+  std::vector<int> free_slabs_;
+  // The slab currently read into, or -1 for `buffer_`.
+  int slab_ = -1;
+  // Small writes are merged into the last chunk, so that typing or scripted
+  // input does not need an iovec per write.
+  std::deque<std::string> write_queue_;
+  // Bytes of the first chunk that were already written.
+  size_t write_offset_ = 0;
+  size_t queued_bytes_ = 0;
+
+  int init_error_ = 0;
+  int poll_events_ = 0;
+  int open_handles_ = 0;
+  bool paused_ = false;
+  // Output handed to the delegate and not yet acknowledged.
+  size_t unacked_ = 0;
+  bool throttled_ = false;
+  bool ended_ = false;
+  bool closed_ = false;
+  bool timer_active_ = false;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_CHANNEL_H_
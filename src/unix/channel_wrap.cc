@@ -0,0 +1,647 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * channel_wrap.cc:
+ *   JS binding of channel::Channel.
+ */
+
+#include "channel_wrap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace channel {
+
+static uint32_t GetUint32Option(Napi::Env env, Napi::Object options, const char *name, uint32_t fallback) {
+  Napi::Value value = options.Get(name);
+  if (value.IsUndefined()) {
+    return fallback;
+  }
+  if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 0) {
+    throw Napi::Error::New(env, std::string("options.") + name + " must be a non-negative number");
+  }
+  return value.As<Napi::Number>().Uint32Value();
+}
+
+static bool GetBoolOption(Napi::Env env, Napi::Object options, const char *name, bool fallback) {
+  Napi::Value value = options.Get(name);
+  if (value.IsUndefined()) {
+    return fallback;
+  }
+  if (!value.IsBoolean()) {
+    throw Napi::Error::New(env, std::string("options.") + name + " must be a boolean");
+  }
+  return value.As<Napi::Boolean>().Value();
+}
+
+Napi::Function ChannelWrap::Init(Napi::Env env) {
+  return DefineClass(env, "Channel", {
+    InstanceMethod("pause", &ChannelWrap::Pause),
+    InstanceMethod("resume", &ChannelWrap::Resume),
+    InstanceMethod("write", &ChannelWrap::Write),
+    InstanceMethod("queuedBytes", &ChannelWrap::QueuedBytes),
+    InstanceMethod("ack", &ChannelWrap::Ack),
+    InstanceMethod("release", &ChannelWrap::Release),
+    InstanceMethod("snapshot", &ChannelWrap::Snapshot),
+    InstanceMethod("match", &ChannelWrap::Match),
+    InstanceMethod("plain", &ChannelWrap::Plain),
+    InstanceMethod("record", &ChannelWrap::Record),
+    InstanceMethod("recordResize", &ChannelWrap::RecordResize),
+    InstanceMethod("compress", &ChannelWrap::Compress),
+    InstanceMethod("forward", &ChannelWrap::Forward),
+    InstanceMethod("close", &ChannelWrap::Close),
+  });
+}
+
+ChannelWrap::ChannelWrap(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<ChannelWrap>(info) {
+  Napi::Env env(info.Env());
+
+  if (info.Length() != 5 ||
+      !info[0].IsNumber() ||
+      !info[1].IsObject() ||
+      !info[2].IsFunction() ||
+      !info[3].IsFunction() ||
+      !info[4].IsFunction()) {
+    throw Napi::Error::New(env, "Usage: new pty.Channel(fd, options, onData, onEnd, onDrain)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+  fd_ = fd;
+  Napi::Object options_ = info[1].As<Napi::Object>();
+  Options options;
+  options.flush_interval = GetUint32Option(env, options_, "flushInterval", options.flush_interval);
+  options.flush_size = GetUint32Option(env, options_, "flushSize", options.flush_size);
+  options.high_watermark = GetUint32Option(env, options_, "highWatermark", options.high_watermark);
+  options.low_watermark = GetUint32Option(env, options_, "lowWatermark", options.high_watermark / 2);
+  if (options.low_watermark > options.high_watermark) {
+    throw Napi::Error::New(env, "options.lowWatermark must not exceed options.highWatermark");
+  }
+  options.utf8 = GetBoolOption(env, options_, "utf8", options.utf8);
+  utf8_ = options.utf8;
+  bool thread = GetBoolOption(env, options_, "thread", false);
+  uint32_t scrollback = GetUint32Option(env, options_, "scrollback", 0);
+  if (scrollback != 0) {
+    scrollback_.reset(new Scrollback(scrollback));
+  }
+
+  Napi::Value pool = options_.Get("pool");
+  if (!pool.IsUndefined()) {
+    if (!pool.IsArray()) {
+      throw Napi::Error::New(env, "options.pool must be an array");
+    }
+    Napi::Array pool_ = pool.As<Napi::Array>();
+    for (uint32_t i = 0; i < pool_.Length(); i++) {
+      Napi::Value slab = pool_.Get(i);
+      if (!slab.IsArrayBuffer() || slab.As<Napi::ArrayBuffer>().ByteLength() < options.flush_size) {
+        throw Napi::Error::New(env, "options.pool must contain ArrayBuffers of at least flushSize bytes");
+      }
+      slabs_.push_back(Napi::Persistent(slab.As<Napi::ArrayBuffer>()));
+    }
+    if (thread && !slabs_.empty()) {
+      throw Napi::Error::New(env, "options.pool is not supported with options.thread");
+    }
+  }
+
+  on_data_ = Napi::Persistent(info[2].As<Napi::Function>());
+  on_end_ = Napi::Persistent(info[3].As<Napi::Function>());
+  on_drain_ = Napi::Persistent(info[4].As<Napi::Function>());
+  async_context_.reset(new Napi::AsyncContext(env, "PtyChannel", Value()));
+
+  if (thread) {
+    // Failing to watch the fd is reported through onEnd.
+    threaded_ = new ThreadedChannel(env, fd, options, this);
+    Ref();
+    return;
+  }
+
+  uv_loop_t *loop;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    throw Napi::Error::New(env, "Could not get the event loop.");
+  }
+  channel_ = new Channel(loop, fd, options, this);
+  for (auto& slab : slabs_) {
+    Napi::ArrayBuffer buffer = slab.Value();
+    channel_->AddSlab(static_cast<char *>(buffer.Data()), buffer.ByteLength());
+  }
+  int err = channel_->Start();
+  if (err != 0) {
+    CloseChannel();
+    throw Napi::Error::New(env, std::string("Could not watch the pty: ") + uv_strerror(err));
+  }
+
+  // Like a libuv handle, an open channel must not be collected.
+  Ref();
+}
+
+ChannelWrap::~ChannelWrap() {
+  CloseChannel();
+}
+
+void ChannelWrap::CloseChannel() {
+  StopPlain();
+  StopRecording();
+  StopCompressing();
+  if (channel_) {
+    channel_->Close();
+    channel_ = nullptr;
+  }
+  if (threaded_) {
+    threaded_->Close();
+    threaded_ = nullptr;
+  }
+}
+
+void ChannelWrap::Emit(const Napi::FunctionReference& cb, const std::vector<napi_value>& args) {
+  try {
+    cb.MakeCallback(Value(), args, *async_context_);
+  } catch (const Napi::Error& e) {
+    // There is no JS caller to throw to, handle it like any other exception
+    // thrown from an event listener.
+    napi_fatal_exception(Env(), e.Value());
+  }
+}
+
+void ChannelWrap::OnData(const char *data, size_t length, int slab) {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+  if (scrollback_) {
+    scrollback_->Append(data, length);
+  }
+  // Exact in a JS number up to 2^53 bytes, 8 PiB of output.
+  uint64_t offset = output_offset_;
+  output_offset_ += length;
+  if (matcher_) {
+    // Scanned before a slab may be released below.
+    matcher_->Scan(data, length, offset, &matches_);
+  }
+  if (plain_text_) {
+    plain_text_->Strip(data, length, &plain_);
+  }
+  if (recorder_) {
+    recorder_->Output(data, length);
+  }
+  if (compressor_ && !compressor_->Compress(data, length, &frame_)) {
+    StopCompressing();
+  }
+  Napi::Value chunk;
+  if (utf8_) {
+    // Chunks end on code point boundaries, they are decoded one at a time.
+    chunk = Napi::String::New(env, data, length);
+    if (slab != -1 && channel_) {
+      channel_->ReleaseSlab(slab);
+    }
+  } else if (slab == -1) {
+    chunk = Napi::Buffer<char>::Copy(env, data, length);
+  } else {
+    chunk = Napi::Number::New(env, slab);
+  }
+  Emit(on_data_, {chunk, Napi::Number::New(env, length), Napi::Number::New(env, offset)});
+
+  // Empty unless the patterns are still the ones scanned for.
+  if (!matches_.empty()) {
+    Napi::Array matches = Napi::Array::New(env, matches_.size() * 2);
+    for (size_t i = 0; i < matches_.size(); i++) {
+      matches.Set(i * 2, Napi::Number::New(env, matches_[i].pattern));
+      matches.Set(i * 2 + 1, Napi::Number::New(env, matches_[i].offset));
+    }
+    matches_.clear();
+    Emit(on_match_, {matches});
+  }
+
+  // Likewise for the plain text tap.
+  if (!plain_.empty()) {
+    if (plain_writer_) {
+      if (!plain_writer_->Write(plain_)) {
+        // There is no one to report to, the tap stops.
+        StopPlain();
+      }
+      plain_.clear();
+    } else {
+      Napi::Value text = utf8_ ?
+          Napi::Value(Napi::String::New(env, plain_)) :
+          Napi::Value(Napi::Buffer<char>::Copy(env, plain_.data(), plain_.size()));
+      plain_.clear();
+      Emit(on_plain_, {text});
+    }
+  }
+
+  // Likewise for compressed frames.
+  if (!frame_.empty()) {
+    if (compress_writer_) {
+      // Frames are queued whole, the stream is only ever cut short.
+      if (!compress_writer_->Write(frame_)) {
+        StopCompressing();
+      }
+      frame_.clear();
+    } else {
+      Napi::Value frame = Napi::Buffer<char>::Copy(env, frame_.data(), frame_.size());
+      frame_.clear();
+      Emit(on_frame_, {frame, Napi::Number::New(env, offset), Napi::Number::New(env, length)});
+    }
+  }
+}
+
+void ChannelWrap::OnEnd(int error) {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+  Napi::Value code = env.Undefined();
+  if (error != 0) {
+    code = Napi::String::New(env, uv_err_name(uv_translate_sys_error(error)));
+  }
+  Emit(on_end_, {code});
+}
+
+void ChannelWrap::OnDrain() {
+  Napi::Env env = Env();
+  Napi::HandleScope scope(env);
+  Emit(on_drain_, {});
+}
+
+Napi::Value ChannelWrap::Pause(const Napi::CallbackInfo& info) {
+  if (channel_) {
+    channel_->Pause();
+  } else if (threaded_) {
+    threaded_->Pause();
+  }
+  return info.Env().Undefined();
+}
+
+Napi::Value ChannelWrap::Resume(const Napi::CallbackInfo& info) {
+  if (forwarding_) {
+    return info.Env().Undefined();
+  }
+  if (channel_) {
+    channel_->Resume();
+  } else if (threaded_) {
+    threaded_->Resume();
+  }
+  return info.Env().Undefined();
+}
+
+Napi::Value ChannelWrap::Write(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 1 || !info[0].IsBuffer()) {
+    throw Napi::Error::New(env, "Usage: channel.write(buffer)");
+  }
+  Napi::Buffer<char> data = info[0].As<Napi::Buffer<char>>();
+  if (recorder_ && record_input_) {
+    recorder_->Input(data.Data(), data.Length());
+  }
+  size_t queued = 0;
+  if (channel_) {
+    queued = channel_->Write(data.Data(), data.Length());
+  } else if (threaded_) {
+    queued = threaded_->Write(data.Data(), data.Length());
+  }
+  return Napi::Number::New(env, queued);
+}
+
+Napi::Value ChannelWrap::QueuedBytes(const Napi::CallbackInfo& info) {
+  size_t queued = 0;
+  if (channel_) {
+    queued = channel_->queued_bytes();
+  } else if (threaded_) {
+    queued = threaded_->queued_bytes();
+  }
+  return Napi::Number::New(info.Env(), queued);
+}
+
+Napi::Value ChannelWrap::Ack(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() > 1 || (info.Length() == 1 && !info[0].IsNumber())) {
+    throw Napi::Error::New(env, "Usage: channel.ack(length?)");
+  }
+  // Without a length everything handed over so far is acknowledged.
+  size_t length = SIZE_MAX;
+  if (info.Length() == 1) {
+    int64_t value = info[0].As<Napi::Number>().Int64Value();
+    length = value > 0 ? value : 0;
+  }
+  if (channel_) {
+    channel_->Ack(length);
+  } else if (threaded_) {
+    threaded_->Ack(length);
+  }
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::Release(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: channel.release(index)");
+  }
+  if (channel_) {
+    channel_->ReleaseSlab(info[0].As<Napi::Number>().Int32Value());
+  }
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::Snapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() > 1 || (info.Length() == 1 && !info[0].IsNumber())) {
+    throw Napi::Error::New(env, "Usage: channel.snapshot(offset?)");
+  }
+  if (!scrollback_) {
+    throw Napi::Error::New(env, "The channel has no scrollback.");
+  }
+  uint64_t offset = scrollback_->start();
+  if (info.Length() == 1) {
+    int64_t value = info[0].As<Napi::Number>().Int64Value();
+    if (value > 0) {
+      offset = std::min(std::max(offset, static_cast<uint64_t>(value)), scrollback_->end());
+    }
+  }
+  size_t length = scrollback_->end() - offset;
+  Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, length);
+  scrollback_->CopyFrom(offset, buffer.Data());
+
+  Napi::Object result = Napi::Object::New(env);
+  if (utf8_) {
+    // Dropping old output may have cut a code point in two, skip the rest of
+    // it. Offsets of chunks are always at a boundary.
+    size_t skip = 0;
+    while (offset == scrollback_->start() && offset > 0 && skip < 3 && skip < length &&
+           (buffer.Data()[skip] & 0xC0) == 0x80) {
+      skip++;
+    }
+    result.Set("offset", Napi::Number::New(env, offset + skip));
+    result.Set("data", Napi::String::New(env, buffer.Data() + skip, length - skip));
+  } else {
+    result.Set("offset", Napi::Number::New(env, offset));
+    result.Set("data", buffer);
+  }
+  return result;
+}
+
+Napi::Value ChannelWrap::Match(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 2 || !info[0].IsArray() || !info[1].IsFunction()) {
+    throw Napi::Error::New(env, "Usage: channel.match(patterns, onMatch)");
+  }
+  Napi::Array array = info[0].As<Napi::Array>();
+  std::vector<std::string> patterns;
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value pattern = array.Get(i);
+    if (!pattern.IsBuffer() || pattern.As<Napi::Buffer<char>>().Length() == 0) {
+      throw Napi::Error::New(env, "patterns must be non-empty Buffers");
+    }
+    Napi::Buffer<char> buffer = pattern.As<Napi::Buffer<char>>();
+    patterns.push_back(std::string(buffer.Data(), buffer.Length()));
+  }
+  // Matches of the patterns replaced, found in a chunk whose onData is
+  // running, are dropped.
+  matches_.clear();
+  if (patterns.empty()) {
+    matcher_.reset();
+    on_match_.Reset();
+  } else {
+    matcher_.reset(new Matcher(patterns));
+    on_match_ = Napi::Persistent(info[1].As<Napi::Function>());
+  }
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::Plain(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() > 1 ||
+      (info.Length() == 1 && !info[0].IsNumber() && !info[0].IsFunction() && !info[0].IsUndefined())) {
+    throw Napi::Error::New(env, "Usage: channel.plain(target?)");
+  }
+  StopPlain();
+  if (info.Length() == 0 || info[0].IsUndefined()) {
+    return env.Undefined();
+  }
+  if (info[0].IsNumber()) {
+    int fd = info[0].As<Napi::Number>().Int32Value();
+    if (fd < 0) {
+      throw Napi::Error::New(env, "target must be a function or an fd");
+    }
+    uv_loop_t *loop;
+    if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+      throw Napi::Error::New(env, "Could not get the event loop.");
+    }
+    // The caller may close its fd while the writer still needs one.
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    plain_writer_ = copy == -1 ? nullptr : FdWriter::Open(loop, copy);
+    if (!plain_writer_) {
+      int error = errno;
+      if (copy != -1) {
+        close(copy);
+      }
+      throw Napi::Error::New(env, std::string("Could not write to the fd: ") + strerror(error));
+    }
+  } else {
+    on_plain_ = Napi::Persistent(info[0].As<Napi::Function>());
+  }
+  plain_text_.reset(new PlainText());
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::Record(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() == 0) {
+    StopRecording();
+    return env.Undefined();
+  }
+  if (info.Length() != 2 || !info[0].IsString() || !info[1].IsObject()) {
+    throw Napi::Error::New(env, "Usage: channel.record(path?, options)");
+  }
+  if (!channel_ && !threaded_) {
+    throw Napi::Error::New(env, "The channel is closed.");
+  }
+  std::string path = info[0].As<Napi::String>();
+  Napi::Object options = info[1].As<Napi::Object>();
+  Napi::Value format_ = options.Get("format");
+  Recorder::Format format = Recorder::kAsciicast;
+  if (format_.IsString() && format_.As<Napi::String>().Utf8Value() == "raw") {
+    format = Recorder::kRaw;
+  } else if (!format_.IsUndefined() &&
+             !(format_.IsString() && format_.As<Napi::String>().Utf8Value() == "asciicast")) {
+    throw Napi::Error::New(env, "options.format must be \"asciicast\" or \"raw\"");
+  }
+  bool input = GetBoolOption(env, options, "input", false);
+  uint32_t cols = GetUint32Option(env, options, "cols", 80);
+  uint32_t rows = GetUint32Option(env, options, "rows", 24);
+
+  uv_loop_t *loop;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    throw Napi::Error::New(env, "Could not get the event loop.");
+  }
+  Recorder *recorder = Recorder::Open(loop, path, format, cols, rows);
+  if (!recorder) {
+    throw Napi::Error::New(env, std::string("open(2) failed: ") + strerror(errno));
+  }
+  StopRecording();
+  recorder_ = recorder;
+  record_input_ = input;
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::RecordResize(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: channel.recordResize(cols, rows)");
+  }
+  if (recorder_) {
+    recorder_->Resize(info[0].As<Napi::Number>().Int32Value(), info[1].As<Napi::Number>().Int32Value());
+  }
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::Compress(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() > 2 ||
+      (info.Length() >= 1 && !info[0].IsNumber() && !info[0].IsFunction() && !info[0].IsUndefined()) ||
+      (info.Length() == 2 && !info[1].IsNumber())) {
+    throw Napi::Error::New(env, "Usage: channel.compress(target?, level?)");
+  }
+  StopCompressing();
+  if (info.Length() == 0 || info[0].IsUndefined()) {
+    return env.Undefined();
+  }
+  int level = Z_DEFAULT_COMPRESSION;
+  if (info.Length() == 2) {
+    level = info[1].As<Napi::Number>().Int32Value();
+    if (level < -1 || level > 9) {
+      throw Napi::Error::New(env, "level must be between -1 and 9");
+    }
+  }
+  int fd = -1;
+  if (info[0].IsNumber()) {
+    fd = info[0].As<Napi::Number>().Int32Value();
+    if (fd < 0) {
+      throw Napi::Error::New(env, "target must be a function or an fd");
+    }
+  }
+  compressor_.reset(Compressor::Create(level, fd != -1));
+  if (!compressor_) {
+    throw Napi::Error::New(env, "Could not initialize zlib.");
+  }
+  if (fd != -1) {
+    uv_loop_t *loop;
+    if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+      compressor_.reset();
+      throw Napi::Error::New(env, "Could not get the event loop.");
+    }
+    // The caller may close its fd while the writer still needs one.
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    compress_writer_ = copy == -1 ? nullptr : FdWriter::Open(loop, copy);
+    if (!compress_writer_) {
+      int error = errno;
+      if (copy != -1) {
+        close(copy);
+      }
+      compressor_.reset();
+      throw Napi::Error::New(env, std::string("Could not write to the fd: ") + strerror(error));
+    }
+  } else {
+    on_frame_ = Napi::Persistent(info[0].As<Napi::Function>());
+  }
+  return env.Undefined();
+}
+
+Napi::Value ChannelWrap::Forward(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsFunction()) {
+    throw Napi::Error::New(env, "Usage: channel.forward(targetFd, onEnd)");
+  }
+  if (!channel_ && !threaded_) {
+    throw Napi::Error::New(env, "The channel is closed.");
+  }
+  if (forwarding_) {
+    throw Napi::Error::New(env, "The channel is forwarded already.");
+  }
+
+  // The relay gets copies of both fds, closing them is up to it.
+  int fds[2] = { fd_, info[0].As<Napi::Number>().Int32Value() };
+  for (int i = 0; i < 2; i++) {
+    int copy = fcntl(fds[i], F_DUPFD_CLOEXEC, 0);
+    int flags = copy == -1 ? -1 : fcntl(copy, F_GETFL);
+    if (flags == -1 || fcntl(copy, F_SETFL, flags | O_NONBLOCK) == -1) {
+      int error = errno;
+      if (copy != -1) {
+        close(copy);
+      }
+      if (i == 1) {
+        close(fds[0]);
+      }
+      throw Napi::Error::New(env, std::string("fcntl(2) failed: ") + strerror(error));
+    }
+    fds[i] = copy;
+  }
+
+  forwarding_ = true;
+  if (channel_) {
+    channel_->Pause();
+  }
+  // Outlives the channel if need be.
+  auto on_end = std::make_shared<Napi::FunctionReference>(Napi::Persistent(info[1].As<Napi::Function>()));
+  // Deletes itself once it ended.
+  new ThreadedRelay(env, fds[0], fds[1], threaded_, [on_end](int error) {
+    Napi::Env env = on_end->Env();
+    Napi::HandleScope scope(env);
+    std::vector<napi_value> args;
+    if (error != 0) {
+      args.push_back(Napi::String::New(env, uv_err_name(uv_translate_sys_error(error))));
+    }
+    try {
+      on_end->Call(args);
+    } catch (const Napi::Error& e) {
+      napi_fatal_exception(env, e.Value());
+    }
+  });
+  return env.Undefined();
+}
+
+void ChannelWrap::StopPlain() {
+  // Text of a chunk whose onData is running goes nowhere.
+  plain_.clear();
+  plain_text_.reset();
+  on_plain_.Reset();
+  if (plain_writer_) {
+    // Writes what is queued before it closes its copy of the fd.
+    plain_writer_->Close();
+    plain_writer_ = nullptr;
+  }
+}
+
+void ChannelWrap::StopCompressing() {
+  // The frame of a chunk whose onData is running goes nowhere.
+  frame_.clear();
+  if (compress_writer_) {
+    // Ends the gzip stream unless writing it failed, then closes the copy
+    // of the fd once everything queued was written.
+    std::string end;
+    if (compressor_ && !compress_writer_->failed() && compressor_->Finish(&end)) {
+      compress_writer_->Write(end);
+    }
+    compress_writer_->Close();
+    compress_writer_ = nullptr;
+  }
+  compressor_.reset();
+  on_frame_.Reset();
+}
+
+void ChannelWrap::StopRecording() {
+  if (recorder_) {
+    recorder_->Close();
+    recorder_ = nullptr;
+  }
+}
+
+Napi::Value ChannelWrap::Close(const Napi::CallbackInfo& info) {
+  if (channel_ || threaded_) {
+    CloseChannel();
+    Unref();
+  }
+  return info.Env().Undefined();
+}
+
+}  // namespace channel
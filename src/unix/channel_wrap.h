@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * channel_wrap.h:
+ *   JS binding of channel::Channel.
+ */
+
+#ifndef NODE_PTY_CHANNEL_WRAP_H_
+#define NODE_PTY_CHANNEL_WRAP_H_
+
+#define NODE_ADDON_API_DISABLE_DEPRECATED
+#include <napi.h>
+#include <memory>
+#include <vector>
+
+#include "channel.h"
+#include "compressor.h"
+#include "fd_writer.h"
+#include "io_thread.h"
+#include "matcher.h"
+#include "plain_text.h"
+#include "recorder.h"
+#include "scrollback.h"
+
+namespace channel {
+
+/**
+ * `new pty.Channel(fd, options, onData, onEnd, onDrain)`
+ *
+ * Runs a Channel on the event loop of the calling thread and forwards its
+ * output to `onData(buffer, length, offset)` and its end to
+ * `onEnd(errorCode?)`. `offset` counts the bytes of output before the chunk. The
+ * object keeps itself alive until `close()` is called.
+ *
+ * `write(buffer)` queues input and returns the number of bytes queued, which
+ * `queuedBytes()` also returns. `onDrain()` is called once the queue is empty.
+ *
+ * `options.pool` may list ArrayBuffers of at least `flushSize` bytes that
+ * output is read into directly. Such output is reported as
+ * `onData(index, length)` and the buffer is not reused before
+ * `release(index)`.
+ *
+ * With `options.highWatermark` the fd is not read while that many bytes of
+ * output were not acknowledged with `ack(length?)`, until no more than
+ * `options.lowWatermark` (half of it by default) are left.
+ *
+ * With `options.utf8` output is cut at code point boundaries only and passed
+ * to `onData` as a string.
+ *
+ * With `options.thread` the channel runs on a shared native I/O thread, see
+ * ThreadedChannel, and `options.pool` must not be given.
+ *
+ * With `options.scrollback` the last that many bytes of output are kept
+ * natively, `snapshot(offset?)` returns `{offset, data}` with the output kept
+ * from byte `offset` of the output on, or from the oldest byte kept.
+ *
+ * `match(patterns, onMatch)` scans all further output for an array of Buffers
+ * and calls `onMatch(matches)` after the `onData` of every chunk that
+ * completed any, `matches` alternating the index of the pattern and the
+ * offset of its first byte. An empty array stops scanning.
+ *
+ * `plain(target?)` strips escape sequences from all further output, see
+ * PlainText, and passes the text to `target(text)` after the `onData` of
+ * every chunk, as a string with `options.utf8`, or writes it to a copy of
+ * `target` if it is an fd, see FdWriter. Without a target it stops.
+ *
+ * `record(path, {format, input, cols, rows})` records all further output,
+ * and input written with `input`, to a new file at `path`, see Recorder.
+ * `format` is "asciicast" or "raw". `recordResize(cols, rows)` records a
+ * resize and `record()` stops recording. It also stops when the channel is
+ * closed.
+ *
+ * `compress(target?, level?)` deflates all further output, see Compressor,
+ * and passes the frame of every chunk to `target(frame, offset, length)`
+ * after its `onData`, `offset` and `length` being those of the chunk. If
+ * `target` is an fd a gzip stream is written to a copy of it instead, see
+ * FdWriter, which is ended when compressing stops. Without a target it stops.
+ *
+ * `forward(targetFd, onEnd)` stops reading the pty and copies between it and
+ * `targetFd` instead, see ThreadedRelay, until either side is closed. Then
+ * `onEnd(errorCode?)` is called, even if the channel was closed since. Input
+ * can still be written.
+ */
+class ChannelWrap : public Napi::ObjectWrap<ChannelWrap>, public Channel::Delegate {
+ public:
+  static Napi::Function Init(Napi::Env env);
+
+  explicit ChannelWrap(const Napi::CallbackInfo& info);
+  ~ChannelWrap();
+
+  // Channel::Delegate
+  void OnData(const char *data, size_t length, int slab) override;
+  void OnEnd(int error) override;
+  void OnDrain() override;
+
+ private:
+  Napi::Value Pause(const Napi::CallbackInfo& info);
+  Napi::Value Resume(const Napi::CallbackInfo& info);
+  Napi::Value Write(const Napi::CallbackInfo& info);
+  Napi::Value QueuedBytes(const Napi::CallbackInfo& info);
+  Napi::Value Ack(const Napi::CallbackInfo& info);
+  Napi::Value Release(const Napi::CallbackInfo& info);
+  Napi::Value Snapshot(const Napi::CallbackInfo& info);
+  Napi::Value Match(const Napi::CallbackInfo& info);
+  Napi::Value Plain(const Napi::CallbackInfo& info);
+  Napi::Value Record(const Napi::CallbackInfo& info);
+  Napi::Value RecordResize(const Napi::CallbackInfo& info);
+  Napi::Value Compress(const Napi::CallbackInfo& info);
+  Napi::Value Forward(const Napi::CallbackInfo& info);
+  Napi::Value Close(const Napi::CallbackInfo& info);
+
+  void CloseChannel();
+  void Emit(const Napi::FunctionReference& cb, const std::vector<napi_value>& args);
+  void StopPlain();
+  void StopRecording();
+  void StopCompressing();
+
+  // One of them is set until the channel is closed.
+  Channel *channel_ = nullptr;
+  ThreadedChannel *threaded_ = nullptr;
+  Napi::FunctionReference on_data_;
+  Napi::FunctionReference on_end_;
+  Napi::FunctionReference on_drain_;
+  Napi::FunctionReference on_match_;
+  Napi::FunctionReference on_plain_;
+  Napi::FunctionReference on_frame_;
+  // Keeps the ArrayBuffers backing the slab pool alive.
+  std::vector<Napi::Reference<Napi::ArrayBuffer>> slabs_;
+  std::unique_ptr<Napi::AsyncContext> async_context_;
+  std::unique_ptr<Scrollback> scrollback_;
+  std::unique_ptr<Matcher> matcher_;
+  std::vector<Matcher::Match> matches_;
+  std::unique_ptr<PlainText> plain_text_;
+  std::string plain_;
+  // Written to instead of calling `on_plain_` if set, deletes itself once
+  // closed.
+  FdWriter *plain_writer_ = nullptr;
+  // Deletes itself once closed.
+  Recorder *recorder_ = nullptr;
+  bool record_input_ = false;
+  std::unique_ptr<Compressor> compressor_;
+  std::string frame_;
+  // Written to instead of calling `on_frame_` if set, deletes itself once
+  // closed.
+  FdWriter *compress_writer_ = nullptr;
+  int fd_;
+  // Set once the output goes to a relay, the channel is not resumed then.
+  bool forwarding_ = false;
+  // Bytes of output handed to `on_data_` so far.
+  uint64_t output_offset_ = 0;
+  bool utf8_ = false;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_CHANNEL_WRAP_H_
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * compressor.cc:
+ *   Streaming compression of the output of a pty.
+ */
+
+#include "compressor.h"
+
+#include <string.h>
+
+namespace channel {
+
+Compressor *Compressor::Create(int level, bool gzip) {
+  Compressor *compressor = new Compressor();
+  memset(&compressor->stream_, 0, sizeof(compressor->stream_));
+  // A negative window is raw deflate, 16 added asks for a gzip wrapper.
+  int window_bits = gzip ? 15 + 16 : -15;
+  if (deflateInit2(&compressor->stream_, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    delete compressor;
+    return nullptr;
+  }
+  return compressor;
+}
+
+Compressor::~Compressor() {
+  deflateEnd(&stream_);
+}
+
+bool Compressor::Compress(const char *data, size_t length, std::string *out) {
+  stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  stream_.avail_in = static_cast<uInt>(length);
+  return Deflate(Z_SYNC_FLUSH, out);
+}
+
+bool Compressor::Finish(std::string *out) {
+  stream_.next_in = nullptr;
+  stream_.avail_in = 0;
+  return Deflate(Z_FINISH, out);
+}
+
+bool Compressor::Deflate(int flush, std::string *out) {
+  char buffer[16384];
+  while (true) {
+    stream_.next_out = reinterpret_cast<Bytef *>(buffer);
+    stream_.avail_out = sizeof(buffer);
+    int status = deflate(&stream_, flush);
+    if (status == Z_STREAM_ERROR) {
+      return false;
+    }
+    out->append(buffer, sizeof(buffer) - stream_.avail_out);
+    // Done once deflate stopped short of filling the buffer, all input is
+    // consumed and flushed then.
+    if (stream_.avail_out != 0 || status == Z_STREAM_END) {
+      return true;
+    }
+  }
+}
+
+}  // namespace channel
@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * compressor.h:
+ *   Streaming compression of the output of a pty.
+ */
+
+#ifndef NODE_PTY_COMPRESSOR_H_
+#define NODE_PTY_COMPRESSOR_H_
+
+#include <stddef.h>
+#include <string>
+#include <zlib.h>
+
+namespace channel {
+
+/**
+ * Deflates a stream chunk by chunk with the zlib that Node.js exports to
+ * addons. All chunks go through one deflate stream, so the history window
+ * (32 KiB) spans chunks and output repeated from earlier ones, such as
+ * redrawn screens and escape sequences, compresses as well as within one.
+ *
+ * Every chunk is sync flushed: its compressed bytes form a frame that a
+ * single inflate stream fed all frames in order decompresses completely.
+ * Frames are raw deflate data, or with `gzip` together a gzip member that
+ * Finish ends.
+ */
+class Compressor {
+ public:
+  // Returns nullptr if zlib could not be initialized.
+  static Compressor *Create(int level, bool gzip);
+  ~Compressor();
+
+  // Appends the frame of the next chunk to `out`. Returns false on errors,
+  // the stream can not be used any further then.
+  bool Compress(const char *data, size_t length, std::string *out);
+  // Appends the end of the stream to `out`.
+  bool Finish(std::string *out);
+
+ private:
+  Compressor() {}
+
+  bool Deflate(int flush, std::string *out);
+
+  z_stream stream_;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_COMPRESSOR_H_
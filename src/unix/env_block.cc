@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * env_block.cc:
+ *   Environments marshalled once and shared by many spawns.
+ */
+
+#include "env_block.h"
+
+namespace spawn {
+
+static EnvPairs ParseArray(Napi::Array array) {
+  auto pairs = std::make_shared<std::vector<std::string>>();
+  pairs->reserve(array.Length());
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value pair = array.Get(i);
+    if (!pair.IsString()) {
+      throw Napi::Error::New(array.Env(), "env must only contain strings");
+    }
+    pairs->push_back(pair.As<Napi::String>());
+  }
+  return pairs;
+}
+
+Napi::Function EnvBlock::Init(Napi::Env env) {
+  return DefineClass(env, "EnvBlock", std::vector<PropertyDescriptor>());
+}
+
+EnvBlock::EnvBlock(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<EnvBlock>(info) {
+  Napi::Env env(info.Env());
+
+  if (info.Length() != 1 ||
+      !info[0].IsArray()) {
+    throw Napi::Error::New(env, "Usage: new pty.EnvBlock(env)");
+  }
+
+  pairs_ = ParseArray(info[0].As<Napi::Array>());
+}
+
+EnvPairs ParseEnv(Napi::Env env, Napi::Value value) {
+  if (value.IsArray()) {
+    return ParseArray(value.As<Napi::Array>());
+  }
+  if (value.IsObject()) {
+    return EnvBlock::Unwrap(value.As<Napi::Object>())->pairs();
+  }
+  throw Napi::Error::New(env, "env must be an array or an EnvBlock");
+}
+
+}  // namespace spawn
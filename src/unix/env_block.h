@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * env_block.h:
+ *   Environments marshalled once and shared by many spawns.
+ */
+
+#ifndef NODE_PTY_ENV_BLOCK_H_
+#define NODE_PTY_ENV_BLOCK_H_
+
+#define NODE_ADDON_API_DISABLE_DEPRECATED
+#include <napi.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace spawn {
+
+typedef std::shared_ptr<const std::vector<std::string>> EnvPairs;
+
+/**
+ * `new pty.EnvBlock(env)`
+ *
+ * Holds the `key=value` strings of `env` in native memory. It can be passed in
+ * place of an environment array to pty.fork and friends, which then spawn
+ * from it without marshalling or copying the environment again.
+ */
+class EnvBlock : public Napi::ObjectWrap<EnvBlock> {
+ public:
+  static Napi::Function Init(Napi::Env env);
+
+  explicit EnvBlock(const Napi::CallbackInfo& info);
+
+  const EnvPairs& pairs() const { return pairs_; }
+
+ private:
+  EnvPairs pairs_;
+};
+
+/**
+ * Returns the environment of `value`, either an array of `key=value` strings
+ * or an EnvBlock, or throws.
+ */
+EnvPairs ParseEnv(Napi::Env env, Napi::Value value);
+
+}  // namespace spawn
+
+#endif  // NODE_PTY_ENV_BLOCK_H_
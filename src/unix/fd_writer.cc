@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * fd_writer.cc:
+ *   Writes to an fd without blocking the event loop.
+ */
+
+#include "fd_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace channel {
+
+// Writing stops once this many bytes wait to be written.
+static const size_t kMaxQueued = 4 * 1024 * 1024;
+
+FdWriter *FdWriter::Open(uv_loop_t *loop, int fd) {
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    return nullptr;
+  }
+  bool pollable = !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode);
+  if (pollable) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+      return nullptr;
+    }
+  }
+  FdWriter *writer = new FdWriter(loop, fd);
+  if (pollable) {
+    int err = uv_poll_init(loop, &writer->poll_, fd);
+    if (err != 0) {
+      delete writer;
+      errno = -err;
+      return nullptr;
+    }
+    // A writer alone must not keep the loop alive.
+    uv_unref(reinterpret_cast<uv_handle_t *>(&writer->poll_));
+    writer->poll_.data = writer;
+    writer->pollable_ = true;
+  }
+  return writer;
+}
+
+FdWriter::FdWriter(uv_loop_t *loop, int fd)
+    : loop_(loop), fd_(fd) {
+  req_.data = this;
+}
+
+bool FdWriter::Write(const char *data, size_t length) {
+  if (failed_ || closing_ || length == 0) {
+    return !failed_;
+  }
+  if (queue_.size() + (writing_.size() - write_offset_) + length > kMaxQueued) {
+    Fail();
+    return false;
+  }
+  queue_.append(data, length);
+  WritePending();
+  return true;
+}
+
+void FdWriter::WritePending() {
+  if (write_active_ || polling_ || failed_) {
+    return;
+  }
+  if (write_offset_ == writing_.size()) {
+    writing_.clear();
+    write_offset_ = 0;
+    writing_.swap(queue_);
+  }
+  if (writing_.empty()) {
+    MaybeDelete();
+    return;
+  }
+  uv_buf_t buf = uv_buf_init(&writing_[write_offset_], writing_.size() - write_offset_);
+  int err = uv_fs_write(loop_, &req_, fd_, &buf, 1, -1, OnWrite);
+  if (err != 0) {
+    uv_fs_req_cleanup(&req_);
+    Fail();
+    MaybeDelete();
+    return;
+  }
+  write_active_ = true;
+}
+
+void FdWriter::OnWrite(uv_fs_t *req) {
+  FdWriter *self = static_cast<FdWriter *>(req->data);
+  ssize_t result = req->result;
+  uv_fs_req_cleanup(req);
+  self->write_active_ = false;
+  if (self->failed_) {
+    // Given up while the write was running.
+    self->MaybeDelete();
+    return;
+  }
+  if (result == UV_EAGAIN && self->pollable_) {
+    self->polling_ = true;
+    uv_poll_start(&self->poll_, UV_WRITABLE, OnPoll);
+    return;
+  }
+  if (result == UV_EINTR) {
+    result = 0;
+  } else if (result <= 0) {
+    self->Fail();
+    self->MaybeDelete();
+    return;
+  }
+  self->write_offset_ += result;
+  self->WritePending();
+}
+
+void FdWriter::OnPoll(uv_poll_t *handle, int status, int events) {
+  FdWriter *self = static_cast<FdWriter *>(handle->data);
+  uv_poll_stop(handle);
+  self->polling_ = false;
+  if (status < 0) {
+    // Most likely the reader went away.
+    self->Fail();
+    self->MaybeDelete();
+    return;
+  }
+  self->WritePending();
+}
+
+void FdWriter::Fail() {
+  failed_ = true;
+  queue_.clear();
+  if (polling_) {
+    uv_poll_stop(&poll_);
+    polling_ = false;
+  }
+  if (!write_active_) {
+    writing_.clear();
+    write_offset_ = 0;
+  }
+}
+
+void FdWriter::Close() {
+  closing_ = true;
+  if (failed_) {
+    MaybeDelete();
+  } else {
+    // Deletes the object once nothing is left to write.
+    WritePending();
+  }
+}
+
+void FdWriter::MaybeDelete() {
+  if (!closing_ || write_active_ || polling_) {
+    return;
+  }
+  if (!failed_ && (write_offset_ < writing_.size() || !queue_.empty())) {
+    return;
+  }
+  close(fd_);
+  fd_ = -1;
+  if (pollable_) {
+    uv_close(reinterpret_cast<uv_handle_t *>(&poll_), OnClosed);
+  } else {
+    delete this;
+  }
+}
+
+void FdWriter::OnClosed(uv_handle_t *handle) {
+  delete static_cast<FdWriter *>(handle->data);
+}
+
+}  // namespace channel
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * fd_writer.h:
+ *   Writes to an fd without blocking the event loop.
+ */
+
+#ifndef NODE_PTY_FD_WRITER_H_
+#define NODE_PTY_FD_WRITER_H_
+
+#include <uv.h>
+#include <stddef.h>
+#include <string>
+
+namespace channel {
+
+/**
+ * Queues data for an fd and writes it with uv_fs_write(), on the threadpool,
+ * one write at a time. Everything queued while a write is running goes out
+ * with the next one.
+ *
+ * Regular files are written as they are. Other fds, such as pipes and
+ * sockets, are made non-blocking so that a write never waits on the
+ * threadpool. When they are full the writer waits for POLLOUT instead.
+ * Writing stops at the first error or once more than 4 MiB are queued, so
+ * that a reader that stopped reading does not make the queue grow without
+ * bounds. Data is never dropped in part: what was queued is either written
+ * in full or writing stopped.
+ *
+ * The writer owns its fd. It must only be used from the thread running its
+ * loop and deletes itself once closed.
+ */
+class FdWriter {
+ public:
+  // Takes over `fd`, returns nullptr with errno set if it could not be made
+  // non-blocking. `fd` is not closed then.
+  static FdWriter *Open(uv_loop_t *loop, int fd);
+
+  // Queues `data`, returns false once writing stopped.
+  bool Write(const char *data, size_t length);
+  bool Write(const std::string &data) { return Write(data.data(), data.size()); }
+  bool failed() const { return failed_; }
+  // Writes what is queued unless writing stopped, then closes the fd. The
+  // object deletes itself.
+  void Close();
+
+ private:
+  FdWriter(uv_loop_t *loop, int fd);
+  ~FdWriter() {}
+
+  static void OnWrite(uv_fs_t *req);
+  static void OnPoll(uv_poll_t *handle, int status, int events);
+  static void OnClosed(uv_handle_t *handle);
+
+  void WritePending();
+  void Fail();
+  void MaybeDelete();
+
+  uv_loop_t *loop_;
+  int fd_;
+  uv_fs_t req_;
+  uv_poll_t poll_;
+  // Set unless the fd is a regular file, which can not be polled.
+  bool pollable_ = false;
+  bool polling_ = false;
+  // The data of the running write, left alone until it completed.
+  std::string writing_;
+  // Bytes of `writing_` that were already written.
+  size_t write_offset_ = 0;
+  bool write_active_ = false;
+  std::string queue_;
+  bool failed_ = false;
+  bool closing_ = false;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_FD_WRITER_H_
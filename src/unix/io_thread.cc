@@ -0,0 +1,598 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * io_thread.cc:
+ *   Channels and relays run on shared native I/O threads.
+ *
+ *   Each I/O thread runs its own libuv loop, which waits on the master fds of
+ *   its channels through epoll (kqueue on macOS). Calls from JS are posted to
+ *   the thread as tasks and wake it through a uv_async_t. Delegate calls of
+ *   the channels are recorded as events and, once per loop iteration, posted
+ *   to the JS thread of each environment as one batch through a
+ *   ThreadSafeFunction.
+ *
+ *   Relays copy between two fds on the same threads and only report to the
+ *   JS thread once they end.
+ */
+
+#include "io_thread.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <uv.h>
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace channel {
+
+struct Event {
+  enum Type { kData, kEnd, kDrain };
+
+  uint64_t id;
+  Type type;
+  std::string data;
+  int error = 0;
+  // Bytes written to the channel when its write queue was emptied.
+  uint64_t drained = 0;
+};
+
+typedef std::vector<Event> EventBatch;
+
+/**
+ * Per environment (main thread or worker) end of the I/O threads. Maps the
+ * client ids of the environment to their clients and owns the
+ * ThreadSafeFunction the I/O threads post batches to.
+ */
+class Sink {
+ public:
+  static std::shared_ptr<Sink> Get(Napi::Env env);
+
+  explicit Sink(Napi::Env env);
+
+  // JS thread.
+  uint64_t Add(IoClient *client);
+  void Remove(uint64_t id);
+  void Dispatch(Napi::Env env, EventBatch *batch);
+  void Close();
+
+  // I/O thread.
+  void Post(EventBatch *batch);
+
+ private:
+  Napi::Env env_;
+  Napi::ThreadSafeFunction tsfn_;
+  std::mutex mutex_;
+  // Set once the environment is torn down, `tsfn_` is gone then.
+  bool closed_ = false;
+  std::unordered_map<uint64_t, IoClient *> clients_;
+  uint64_t next_id_ = 1;
+  bool referenced_ = false;
+};
+
+class IoThread {
+ public:
+  // Returns the least busy thread, starting a new one while the pool is not
+  // full, and counts a channel (or relay) against it.
+  static IoThread *Acquire();
+  static void SetPoolSize(size_t size);
+
+  // Any thread.
+  void Post(std::function<void()> task);
+
+  // I/O thread.
+  uv_loop_t *loop() { return &loop_; }
+  // Records `event` for the JS thread of `sink`, it is delivered before the
+  // loop blocks again.
+  void Emit(const std::shared_ptr<Sink> &sink, Event event);
+  // Counts another channel against the thread.
+  void Retain();
+  // Counts a closed channel against the thread.
+  void Release();
+
+ private:
+  IoThread();
+
+  static void OnAsync(uv_async_t *handle);
+  static void OnPrepare(uv_prepare_t *handle);
+
+  uv_loop_t loop_;
+  uv_async_t async_;
+  uv_prepare_t prepare_;
+
+  std::mutex mutex_;
+  std::vector<std::function<void()>> tasks_;
+
+  struct PendingBatch {
+    std::shared_ptr<Sink> sink;
+    EventBatch events;
+  };
+  std::unordered_map<Sink *, PendingBatch> batches_;
+
+  // Guarded by `pool_mutex`.
+  size_t channels_ = 0;
+};
+
+namespace {
+
+std::mutex sinks_mutex;
+std::unordered_map<napi_env, std::shared_ptr<Sink>> sinks;
+
+std::mutex pool_mutex;
+std::vector<IoThread *> pool;
+size_t pool_size = 1;
+
+void CleanupSink(void *arg) {
+  Sink *sink = static_cast<Sink *>(arg);
+  std::shared_ptr<Sink> owner;
+  {
+    std::lock_guard<std::mutex> lock(sinks_mutex);
+    for (auto it = sinks.begin(); it != sinks.end(); ++it) {
+      if (it->second.get() == sink) {
+        owner = std::move(it->second);
+        sinks.erase(it);
+        break;
+      }
+    }
+  }
+  // Channels still open are closed by their wrappers, their events dropped.
+  sink->Close();
+}
+
+}  // namespace
+
+std::shared_ptr<Sink> Sink::Get(Napi::Env env) {
+  std::lock_guard<std::mutex> lock(sinks_mutex);
+  auto it = sinks.find(env);
+  if (it != sinks.end()) {
+    return it->second;
+  }
+  std::shared_ptr<Sink> sink = std::make_shared<Sink>(env);
+  sinks[env] = sink;
+  napi_add_env_cleanup_hook(env, CleanupSink, sink.get());
+  return sink;
+}
+
+Sink::Sink(Napi::Env env) : env_(env) {
+  // The JS function is unused, events are dispatched per channel.
+  Napi::Function noop = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+  tsfn_ = Napi::ThreadSafeFunction::New(
+      env,
+      noop,
+      "pty_io_thread",
+      0,  // Unlimited queue
+      1);
+  // Only keep the event loop alive while there are open channels.
+  tsfn_.Unref(env);
+}
+
+uint64_t Sink::Add(IoClient *client) {
+  if (!referenced_ && !closed_) {
+    referenced_ = true;
+    tsfn_.Ref(env_);
+  }
+  uint64_t id = next_id_++;
+  clients_[id] = client;
+  return id;
+}
+
+void Sink::Remove(uint64_t id) {
+  clients_.erase(id);
+  if (clients_.empty() && referenced_ && !closed_) {
+    referenced_ = false;
+    tsfn_.Unref(env_);
+  }
+}
+
+void Sink::Post(EventBatch *batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  napi_status status = napi_closing;
+  if (!closed_) {
+    status = tsfn_.NonBlockingCall(batch, [this](Napi::Env env, Napi::Function, EventBatch *batch) {
+      Dispatch(env, batch);
+    });
+  }
+  if (status != napi_ok) {
+    // The environment is shutting down.
+    delete batch;
+  }
+}
+
+void Sink::Dispatch(Napi::Env env, EventBatch *batch) {
+  std::unique_ptr<EventBatch> events(batch);
+  for (const Event &event : *events) {
+    // Events of a client closed since are dropped. A client may be closed
+    // by a delegate call, so it is looked up again for every event.
+    auto it = clients_.find(event.id);
+    if (it != clients_.end()) {
+      it->second->Deliver(event);
+    }
+  }
+}
+
+void Sink::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  clients_.clear();
+  tsfn_.Release();
+}
+
+IoThread *IoThread::Acquire() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  IoThread *thread = nullptr;
+  for (IoThread *candidate : pool) {
+    if (!thread || candidate->channels_ < thread->channels_) {
+      thread = candidate;
+    }
+  }
+  if (pool.size() < pool_size && (!thread || thread->channels_ > 0)) {
+    // Intentionally leaked, the thread lives as long as the process.
+    thread = new IoThread();
+    pool.push_back(thread);
+  }
+  thread->channels_++;
+  return thread;
+}
+
+void IoThread::SetPoolSize(size_t size) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  pool_size = size;
+}
+
+void IoThread::Retain() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  channels_++;
+}
+
+void IoThread::Release() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  channels_--;
+}
+
+IoThread::IoThread() {
+  if (uv_loop_init(&loop_) != 0 ||
+      uv_async_init(&loop_, &async_, OnAsync) != 0) {
+    Napi::Error::Fatal("io_thread", "Could not create event loop");
+  }
+  async_.data = this;
+  uv_prepare_init(&loop_, &prepare_);
+  prepare_.data = this;
+  uv_prepare_start(&prepare_, OnPrepare);
+  uv_unref(reinterpret_cast<uv_handle_t *>(&prepare_));
+
+  std::thread([this] { uv_run(&loop_, UV_RUN_DEFAULT); }).detach();
+}
+
+void IoThread::Post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  uv_async_send(&async_);
+}
+
+void IoThread::OnAsync(uv_async_t *handle) {
+  IoThread *self = static_cast<IoThread *>(handle->data);
+  std::vector<std::function<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    tasks.swap(self->tasks_);
+  }
+  for (auto &task : tasks) {
+    task();
+  }
+}
+
+void IoThread::Emit(const std::shared_ptr<Sink> &sink, Event event) {
+  PendingBatch &batch = batches_[sink.get()];
+  if (!batch.sink) {
+    batch.sink = sink;
+  }
+  EventBatch &events = batch.events;
+  if (event.type == Event::kData && !events.empty() &&
+      events.back().id == event.id && events.back().type == Event::kData) {
+    // Chunks are complete on their own, so are two of them in a row.
+    events.back().data.append(event.data);
+    return;
+  }
+  events.push_back(std::move(event));
+}
+
+void IoThread::OnPrepare(uv_prepare_t *handle) {
+  // Runs right before the loop blocks for I/O, everything emitted by the
+  // callbacks since it last blocked is handed over now.
+  IoThread *self = static_cast<IoThread *>(handle->data);
+  if (self->batches_.empty()) {
+    return;
+  }
+  for (auto &it : self->batches_) {
+    it.second.sink->Post(new EventBatch(std::move(it.second.events)));
+  }
+  self->batches_.clear();
+}
+
+void ThreadedChannel::SetPoolSize(size_t size) {
+  IoThread::SetPoolSize(size);
+}
+
+ThreadedChannel::ThreadedChannel(Napi::Env env, int fd, const Options &options, Channel::Delegate *delegate)
+    : thread_(IoThread::Acquire()), sink_(Sink::Get(env)), delegate_(delegate) {
+  id_ = sink_->Add(this);
+  thread_->Post([this, fd, options] {
+    channel_ = new Channel(thread_->loop(), fd, options, this);
+    int err = channel_->Start();
+    if (err != 0) {
+      // libuv errors are negated errnos on Unix.
+      OnEnd(-err);
+    }
+  });
+}
+
+void ThreadedChannel::Pause() {
+  thread_->Post([this] { channel_->Pause(); });
+}
+
+void ThreadedChannel::Resume() {
+  thread_->Post([this] { channel_->Resume(); });
+}
+
+size_t ThreadedChannel::Write(const char *data, size_t length) {
+  if (ended_) {
+    return 0;
+  }
+  written_ += length;
+  std::string chunk(data, length);
+  thread_->Post([this, chunk] {
+    accepted_ += chunk.size();
+    channel_->Write(chunk.data(), chunk.size());
+  });
+  return queued_bytes();
+}
+
+void ThreadedChannel::Ack(size_t length) {
+  thread_->Post([this, length] { channel_->Ack(length); });
+}
+
+void ThreadedChannel::Close() {
+  sink_->Remove(id_);
+  thread_->Post([this] {
+    channel_->Close();
+    thread_->Release();
+    delete this;
+  });
+}
+
+void ThreadedChannel::Deliver(const Event &event) {
+  // The delegate may close the channel, nothing is touched after calling it.
+  switch (event.type) {
+    case Event::kData:
+      delegate_->OnData(event.data.data(), event.data.size(), -1);
+      break;
+    case Event::kEnd:
+      // Nothing is written afterwards, like the queue of the channel.
+      ended_ = true;
+      drained_ = written_;
+      delegate_->OnEnd(event.error);
+      break;
+    case Event::kDrain:
+      drained_ = event.drained;
+      delegate_->OnDrain();
+      break;
+  }
+}
+
+void ThreadedChannel::OnData(const char *data, size_t length, int slab) {
+  Event event;
+  event.id = id_;
+  event.type = Event::kData;
+  event.data.assign(data, length);
+  thread_->Emit(sink_, std::move(event));
+}
+
+void ThreadedChannel::OnEnd(int error) {
+  Event event;
+  event.id = id_;
+  event.type = Event::kEnd;
+  event.error = error;
+  thread_->Emit(sink_, std::move(event));
+}
+
+void ThreadedChannel::OnDrain() {
+  Event event;
+  event.id = id_;
+  event.type = Event::kDrain;
+  event.drained = accepted_;
+  thread_->Emit(sink_, std::move(event));
+}
+
+// Bytes read from one side of a relay and not yet written to the other. The
+// side is not read from while there are this many.
+static const size_t kRelayBufferSize = 65536;
+
+ThreadedRelay::ThreadedRelay(Napi::Env env, int fd, int target_fd, ThreadedChannel *channel,
+                             std::function<void(int error)> on_end)
+    : thread_(channel ? channel->thread_ : IoThread::Acquire()), sink_(Sink::Get(env)), on_end_(std::move(on_end)) {
+  if (channel) {
+    thread_->Retain();
+  }
+  id_ = sink_->Add(this);
+  sides_[0].fd = fd;
+  sides_[1].fd = target_fd;
+  // Runs before any task posted later, closing the channel for one.
+  thread_->Post([this, channel] {
+    if (channel) {
+      channel->channel_->Pause();
+    }
+    Start();
+  });
+}
+
+void ThreadedRelay::Deliver(const Event &event) {
+  // The only event is the end.
+  sink_->Remove(id_);
+  std::function<void(int error)> on_end = std::move(on_end_);
+  thread_->Post([this] {
+    released_ = true;
+    MaybeDelete();
+  });
+  on_end(event.error);
+}
+
+void ThreadedRelay::Start() {
+  for (Side &side : sides_) {
+    int err = uv_poll_init(thread_->loop(), &side.poll, side.fd);
+    if (err != 0) {
+      // libuv errors are negated errnos on Unix.
+      Finish(-err);
+      return;
+    }
+    side.poll.data = this;
+    side.polled = true;
+    open_handles_++;
+  }
+  Update();
+}
+
+void ThreadedRelay::OnPoll(uv_poll_t *handle, int status, int events) {
+  ThreadedRelay *self = static_cast<ThreadedRelay *>(handle->data);
+  Side *side = &self->sides_[0];
+  Side *other = &self->sides_[1];
+  if (handle != &side->poll) {
+    std::swap(side, other);
+  }
+  if (status < 0) {
+    // libuv reports EPOLLERR as EBADF, which is how a socket whose peer is
+    // gone shows up. What is left is read, nothing can be written anymore,
+    // and libuv stopped polling the side already.
+    side->events = 0;
+    if (!self->Read(side, other)) {
+      return;
+    }
+    side->eof = true;
+    side->pending.clear();
+  }
+  if ((events & UV_WRITABLE) && !self->Flush(side)) {
+    return;
+  }
+  if ((events & (UV_READABLE | UV_DISCONNECT)) && !self->Read(side, other)) {
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    // Done once a side is closed and all it sent is passed on.
+    if (self->sides_[i].eof && self->sides_[1 - i].pending.empty()) {
+      self->Finish(0);
+      return;
+    }
+  }
+  self->Update();
+}
+
+bool ThreadedRelay::Read(Side *from, Side *to) {
+  char buffer[kRelayBufferSize];
+  while (!from->eof && to->pending.size() < kRelayBufferSize) {
+    ssize_t n = read(from->fd, buffer, kRelayBufferSize - to->pending.size());
+    if (n > 0) {
+      to->pending.append(buffer, n);
+      continue;
+    }
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    // The master reads EIO once all slave fds are closed on Linux, and 0 on
+    // macOS.
+    if (n == 0 || errno == EIO || errno == ECONNRESET) {
+      from->eof = true;
+      break;
+    }
+    Finish(errno);
+    return false;
+  }
+  // Written right away, most of the time nothing is left to poll for.
+  return Flush(to);
+}
+
+bool ThreadedRelay::Flush(Side *side) {
+  size_t written = 0;
+  while (written < side->pending.size()) {
+    ssize_t n = write(side->fd, side->pending.data() + written, side->pending.size() - written);
+    if (n >= 0) {
+      written += n;
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    }
+    // The side was closed, which ends the relay like reading its end does.
+    Finish(errno == EPIPE || errno == EIO || errno == ECONNRESET ? 0 : errno);
+    return false;
+  }
+  side->pending.erase(0, written);
+  return true;
+}
+
+void ThreadedRelay::Update() {
+  for (int i = 0; i < 2; i++) {
+    Side &side = sides_[i];
+    const Side &other = sides_[1 - i];
+    int events = 0;
+    if (!side.eof && other.pending.size() < kRelayBufferSize) {
+      events |= UV_READABLE;
+    }
+    if (!side.pending.empty()) {
+      events |= UV_WRITABLE;
+    }
+    if (events == side.events) {
+      continue;
+    }
+    side.events = events;
+    if (events) {
+      uv_poll_start(&side.poll, events, OnPoll);
+    } else {
+      uv_poll_stop(&side.poll);
+    }
+  }
+}
+
+void ThreadedRelay::Finish(int error) {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  for (Side &side : sides_) {
+    if (side.polled) {
+      uv_close(reinterpret_cast<uv_handle_t *>(&side.poll), OnClosed);
+    }
+    close(side.fd);
+  }
+  Event event;
+  event.id = id_;
+  event.type = Event::kEnd;
+  event.error = error;
+  thread_->Emit(sink_, std::move(event));
+}
+
+void ThreadedRelay::OnClosed(uv_handle_t *handle) {
+  ThreadedRelay *self = static_cast<ThreadedRelay *>(handle->data);
+  self->open_handles_--;
+  self->MaybeDelete();
+}
+
+void ThreadedRelay::MaybeDelete() {
+  if (released_ && open_handles_ == 0) {
+    thread_->Release();
+    delete this;
+  }
+}
+
+}  // namespace channel
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * io_thread.h:
+ *   Channels and relays run on shared native I/O threads.
+ */
+
+#ifndef NODE_PTY_IO_THREAD_H_
+#define NODE_PTY_IO_THREAD_H_
+
+#define NODE_ADDON_API_DISABLE_DEPRECATED
+#include <napi.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "channel.h"
+
+namespace channel {
+
+class IoThread;
+class Sink;
+struct Event;
+
+/**
+ * Something run on an I/O thread that reports to the JS thread through the
+ * sink of its environment.
+ */
+class IoClient {
+ public:
+  // JS thread, called by the sink with an event of this client.
+  virtual void Deliver(const Event &event) = 0;
+
+ protected:
+  ~IoClient() {}
+};
+
+/**
+ * Runs a Channel on one of a small pool of native I/O threads instead of the
+ * loop of the JS thread, so that reading, writing, buffering and flow control
+ * go on while the JS thread is busy or collecting garbage.
+ *
+ * The methods are called on the JS thread and carried out on the I/O thread
+ * in the order they were called. The delegate is called on the JS thread, with
+ * the output of all channels of that thread that was flushed in one iteration
+ * of the I/O loop delivered in a single batch. Output is always copied, pool
+ * slabs are not supported.
+ */
+class ThreadedChannel : public IoClient, private Channel::Delegate {
+ public:
+  // Sets the number of I/O threads new channels are spread over, 1 by
+  // default. Threads are started on demand and are never stopped.
+  static void SetPoolSize(size_t size);
+
+  ThreadedChannel(Napi::Env env, int fd, const Options &options, Channel::Delegate *delegate);
+
+  void Pause();
+  void Resume();
+  // Returns the number of bytes written and not yet known to have reached
+  // the fd, like Channel::Write.
+  size_t Write(const char *data, size_t length);
+  size_t queued_bytes() const { return written_ - drained_; }
+  void Ack(size_t length);
+  // Stops all I/O and closes the fd. The delegate is not called afterwards
+  // and the object deletes itself on the I/O thread.
+  void Close();
+
+  void Deliver(const Event &event) override;
+
+ private:
+  ~ThreadedChannel() {}
+
+  // Channel::Delegate, called on the I/O thread.
+  void OnData(const char *data, size_t length, int slab) override;
+  void OnEnd(int error) override;
+  void OnDrain() override;
+
+  friend class ThreadedRelay;
+
+  IoThread *thread_;
+  std::shared_ptr<Sink> sink_;
+  uint64_t id_;
+
+  // JS thread.
+  Channel::Delegate *delegate_;
+  uint64_t written_ = 0;
+  // Bytes of `written_` the I/O thread reported as written on its last drain.
+  uint64_t drained_ = 0;
+  bool ended_ = false;
+
+  // I/O thread.
+  Channel *channel_ = nullptr;
+  uint64_t accepted_ = 0;
+};
+
+/**
+ * Copies everything read from one fd to the other and the other way around
+ * on an I/O thread, without involving the JS thread, until either side is
+ * closed and what was read from it is written to the other side, or until
+ * either fails. `on_end` is called on the JS thread then, with 0 or the
+ * errno of the failure, and the relay deletes itself.
+ *
+ * Takes ownership of both fds, which must be non-blocking and pollable,
+ * such as ptys, pipes and sockets. With `channel`, the channel of `fd`, the
+ * relay runs on the thread of the channel and pauses it first, so that the
+ * channel reads nothing the relay should have.
+ */
+class ThreadedRelay final : public IoClient {
+ public:
+  ThreadedRelay(Napi::Env env, int fd, int target_fd, ThreadedChannel *channel,
+                std::function<void(int error)> on_end);
+
+  void Deliver(const Event &event) override;
+
+ private:
+  struct Side {
+    int fd;
+    uv_poll_t poll;
+    // Read from the other side, to be written to this one.
+    std::string pending;
+    bool eof = false;
+    bool polled = false;
+    int events = 0;
+  };
+
+  ~ThreadedRelay() {}
+
+  // I/O thread.
+  static void OnPoll(uv_poll_t *handle, int status, int events);
+  static void OnClosed(uv_handle_t *handle);
+  void Start();
+  // Both return false once the relay finished.
+  bool Read(Side *from, Side *to);
+  bool Flush(Side *side);
+  void Update();
+  void Finish(int error);
+  void MaybeDelete();
+
+  IoThread *thread_;
+  std::shared_ptr<Sink> sink_;
+  uint64_t id_;
+
+  // JS thread.
+  std::function<void(int error)> on_end_;
+
+  // I/O thread.
+  Side sides_[2];
+  int open_handles_ = 0;
+  bool finished_ = false;
+  // Set once the JS thread is done with the relay.
+  bool released_ = false;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_IO_THREAD_H_
@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * matcher.cc:
+ *   Multi-pattern search over the output of a pty.
+ */
+
+#include "matcher.h"
+
+#include <string.h>
+#include <queue>
+
+namespace channel {
+
+Matcher::Matcher(const std::vector<std::string> &patterns) {
+  // Bytes that occur in no pattern all lead back towards the root alike.
+  memset(class_, 0, sizeof(class_));
+  for (const std::string &pattern : patterns) {
+    for (unsigned char byte : pattern) {
+      if (class_[byte] == 0) {
+        class_[byte] = classes_++;
+      }
+    }
+  }
+
+  // The trie, a missing edge is 0 as no edge leads back to the root.
+  next_.assign(classes_, 0);
+  outputs_.resize(1);
+  for (uint32_t i = 0; i < patterns.size(); i++) {
+    uint32_t state = 0;
+    for (unsigned char byte : patterns[i]) {
+      uint32_t &next = next_[state * classes_ + class_[byte]];
+      if (next == 0) {
+        next = static_cast<uint32_t>(outputs_.size());
+        outputs_.emplace_back();
+        next_.resize(next_.size() + classes_, 0);
+      }
+      // `next` may have moved with the resize.
+      state = next_[state * classes_ + class_[byte]];
+    }
+    outputs_[state].push_back(i);
+    lengths_.push_back(patterns[i].size());
+  }
+
+  // Fill in the missing edges breadth first, each state continues like its
+  // failure state, the longest proper suffix of it that is in the trie.
+  std::vector<uint32_t> failure(outputs_.size(), 0);
+  output_links_.assign(outputs_.size(), 0);
+  std::queue<uint32_t> queue;
+  for (uint32_t c = 0; c < classes_; c++) {
+    if (next_[c] != 0) {
+      queue.push(next_[c]);
+    }
+  }
+  while (!queue.empty()) {
+    uint32_t state = queue.front();
+    queue.pop();
+    for (uint32_t c = 0; c < classes_; c++) {
+      uint32_t &next = next_[state * classes_ + c];
+      uint32_t fallback = next_[failure[state] * classes_ + c];
+      if (next == 0) {
+        next = fallback;
+        continue;
+      }
+      failure[next] = fallback;
+      output_links_[next] = outputs_[fallback].empty() ? output_links_[fallback] : fallback;
+      queue.push(next);
+    }
+  }
+}
+
+void Matcher::Scan(const char *data, size_t length, uint64_t offset, std::vector<Match> *matches) {
+  uint32_t state = state_;
+  for (size_t i = 0; i < length; i++) {
+    state = Next(state, static_cast<unsigned char>(data[i]));
+    uint32_t output = outputs_[state].empty() ? output_links_[state] : state;
+    while (output != 0) {
+      for (uint32_t pattern : outputs_[output]) {
+        matches->push_back({pattern, offset + i + 1 - lengths_[pattern]});
+      }
+      output = output_links_[output];
+    }
+  }
+  state_ = state;
+}
+
+}  // namespace channel
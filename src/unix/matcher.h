@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * matcher.h:
+ *   Multi-pattern search over the output of a pty.
+ */
+
+#ifndef NODE_PTY_MATCHER_H_
+#define NODE_PTY_MATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace channel {
+
+/**
+ * Finds every occurrence of a set of byte patterns in a stream with an
+ * Aho-Corasick automaton, in a single pass over each byte. Matches that span
+ * chunks are found as well, the state carries over from one Scan to the next.
+ *
+ * The transitions are a dense table over the classes of bytes the patterns
+ * distinguish, all other bytes share a class, so the table stays small for
+ * the short markers it is meant for.
+ */
+class Matcher {
+ public:
+  struct Match {
+    // The index of the pattern.
+    uint32_t pattern;
+    // The offset in the stream of the first byte of the match.
+    uint64_t offset;
+  };
+
+  // `patterns` must not be empty strings.
+  explicit Matcher(const std::vector<std::string> &patterns);
+
+  // Scans the next `length` bytes of the stream, `offset` being the number of
+  // bytes before them, and appends the matches ending in them to `matches`.
+  void Scan(const char *data, size_t length, uint64_t offset, std::vector<Match> *matches);
+
+ private:
+  uint32_t Next(uint32_t state, unsigned char byte) const {
+    return next_[state * classes_ + class_[byte]];
+  }
+
+  std::vector<size_t> lengths_;
+  uint8_t class_[256];
+  uint32_t classes_ = 1;
+  // `classes_` transitions per state, state 0 is the root.
+  std::vector<uint32_t> next_;
+  // The patterns ending in each state.
+  std::vector<std::vector<uint32_t>> outputs_;
+  // The closest state along the failure links that has outputs, 0 for none.
+  std::vector<uint32_t> output_links_;
+  uint32_t state_ = 0;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_MATCHER_H_
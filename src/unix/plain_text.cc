@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * plain_text.cc:
+ *   Strips escape sequences from the output of a pty.
+ */
+
+#include "plain_text.h"
+
+namespace channel {
+
+static const unsigned char kEsc = 0x1b;
+static const unsigned char kBel = 0x07;
+static const unsigned char kCan = 0x18;
+static const unsigned char kSub = 0x1a;
+static const unsigned char kDel = 0x7f;
+
+static inline bool IsText(unsigned char byte) {
+  return (byte >= 0x20 && byte != kDel) || byte == '\n' || byte == '\t';
+}
+
+void PlainText::Strip(const char *data, size_t length, std::string *out) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+  const unsigned char *end = p + length;
+  while (p < end) {
+    if (state_ == kGround) {
+      // Most output is text, copy whole runs of it at once.
+      const unsigned char *run = p;
+      while (p < end && IsText(*p)) {
+        p++;
+      }
+      out->append(reinterpret_cast<const char *>(run), p - run);
+      if (p == end) {
+        break;
+      }
+      // Any other control is dropped.
+      if (*p == kEsc) {
+        state_ = kEscape;
+      }
+      p++;
+      continue;
+    }
+
+    unsigned char byte = *p;
+    if (byte == kCan || byte == kSub) {
+      // Cancels any sequence.
+      state_ = kGround;
+      p++;
+      continue;
+    }
+    switch (state_) {
+      case kEscape:
+        if (byte == '[') {
+          state_ = kCsi;
+        } else if (byte == ']') {
+          state_ = kOsc;
+        } else if (byte == 'P' || byte == 'X' || byte == '^' || byte == '_') {
+          state_ = kString;
+        } else if (byte >= 0x20 && byte <= 0x2f) {
+          state_ = kEscapeIntermediate;
+        } else if (byte >= 0x30 && byte < kDel) {
+          state_ = kGround;
+        }
+        // ESC starts over, other controls are executed and not part of it.
+        break;
+      case kEscapeIntermediate:
+        if (byte == kEsc) {
+          state_ = kEscape;
+        } else if (byte >= 0x30 && byte < kDel) {
+          state_ = kGround;
+        }
+        break;
+      case kCsi:
+        if (byte == kEsc) {
+          state_ = kEscape;
+        } else if (byte >= 0x40 && byte < kDel) {
+          state_ = kGround;
+        }
+        break;
+      case kOsc:
+        // Terminated by BEL as well, like xterm does.
+        if (byte == kBel) {
+          state_ = kGround;
+        } else if (byte == kEsc) {
+          state_ = kStringEscape;
+        }
+        break;
+      case kString:
+        if (byte == kEsc) {
+          state_ = kStringEscape;
+        }
+        break;
+      case kStringEscape:
+        if (byte == '\\') {
+          state_ = kGround;
+          break;
+        }
+        // Anything else aborts the string and starts another sequence.
+        state_ = kEscape;
+        continue;
+      case kGround:
+        break;
+    }
+    p++;
+  }
+}
+
+}  // namespace channel
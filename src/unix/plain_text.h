@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * plain_text.h:
+ *   Strips escape sequences from the output of a pty.
+ */
+
+#ifndef NODE_PTY_PLAIN_TEXT_H_
+#define NODE_PTY_PLAIN_TEXT_H_
+
+#include <stddef.h>
+#include <string>
+
+namespace channel {
+
+/**
+ * Turns terminal output into plain text by dropping escape sequences (CSI,
+ * OSC, DCS, SOS, PM, APC and the short ESC ones) and all control characters
+ * but tabs and line feeds. Follows the parser of a VT500 closely enough that
+ * sequences are dropped as a terminal would consume them, cancelled by CAN
+ * and SUB, and the state carries over from one chunk to the next.
+ *
+ * 8-bit C1 controls are not recognized, in UTF-8 they are continuation bytes.
+ */
+class PlainText {
+ public:
+  // Appends the text of the next `length` bytes of output to `out`.
+  void Strip(const char *data, size_t length, std::string *out);
+
+ private:
+  enum State {
+    kGround,
+    kEscape,
+    kEscapeIntermediate,
+    kCsi,
+    kOsc,
+    // DCS, SOS, PM and APC, ended by ST only.
+    kString,
+    // ESC within a string, ST if followed by a backslash.
+    kStringEscape
+  };
+
+  State state_ = kGround;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_PLAIN_TEXT_H_
@@ -33,6 +33,19 @@
 #include <fcntl.h>
 #include <signal.h>
 
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "channel_wrap.h"
+#include "env_block.h"
+#include "io_thread.h"
+#include "reaper.h"
+#include "spawn_request.h"
+#include "zygote.h"
+
 /* forkpty */
 /* http://www.gnu.org/software/gnulib/manual/html_node/forkpty.html */
 #if defined(__linux__)
@@ -56,6 +69,10 @@
 #if defined(__linux__)
 #include <stdio.h>
 #include <stdint.h>
+#include <sched.h>
+#include <termios.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #elif defined(__APPLE__)
 #include <libproc.h>
 #include <os/availability.h>
@@ -108,6 +125,10 @@ struct ExitEvent {
 };
 
 void SetupExitCallback(Napi::Env env, Napi::Function cb, pid_t pid) {
+#if defined(__linux__)
+  // One shared thread watches all children, see reaper.cc.
+  reaper::Watch(env, cb, pid);
+#else
   std::thread *th = new std::thread;
   // Don't use Napi::AsyncWorker which is limited by UV_THREADPOOL_SIZE.
   auto tsfn = Napi::ThreadSafeFunction::New(
@@ -207,6 +228,7 @@ void SetupExitCallback(Napi::Env env, Napi::Function cb, pid_t pid) {
         Napi::Error::Fatal("SetupExitCallback", "ThreadSafeFunction.BlockingCall() failed");
     }
   });
+#endif
 }
 
 /**
@@ -214,9 +236,19 @@ void SetupExitCallback(Napi::Env env, Napi::Function cb, pid_t pid) {
  */
 
 Napi::Value PtyFork(const Napi::CallbackInfo& info);
+Napi::Value PtyForkAsync(const Napi::CallbackInfo& info);
+Napi::Value PtyForkMany(const Napi::CallbackInfo& info);
+Napi::Value PtyStartZygote(const Napi::CallbackInfo& info);
 Napi::Value PtyOpen(const Napi::CallbackInfo& info);
 Napi::Value PtyResize(const Napi::CallbackInfo& info);
+Napi::Value PtyOpenSlave(const Napi::CallbackInfo& info);
+Napi::Value PtyInputQueue(const Napi::CallbackInfo& info);
+Napi::Value PtySetIoThreadPoolSize(const Napi::CallbackInfo& info);
+Napi::Value PtyDetach(const Napi::CallbackInfo& info);
+Napi::Value PtyAdopt(const Napi::CallbackInfo& info);
 Napi::Value PtyGetProc(const Napi::CallbackInfo& info);
+Napi::Value PtyProcessMany(const Napi::CallbackInfo& info);
+Napi::Value PtyForegroundGroup(const Napi::CallbackInfo& info);
 
 /**
  * Functions
@@ -225,12 +257,34 @@ Napi::Value PtyGetProc(const Napi::CallbackInfo& info);
 static int
 pty_nonblock(int);
 
-#if defined(__APPLE__)
 static char *
 pty_getproc(int);
-#else
-static char *
-pty_getproc(int, char *);
+
+static void
+pty_forgetproc(int);
+
+/**
+ * The foreground process group of a pty and the command line of its leader.
+ */
+struct ForegroundProcess {
+  bool found = false;
+  pid_t pgrp = -1;
+  std::string name;
+  std::vector<std::string> argv;
+};
+
+static void
+pty_getforeground(int, ForegroundProcess *);
+
+#if defined(__linux__)
+static int
+pty_clone_spawn(char** argv, char** env,
+                const char* cwd, int uid, int gid,
+                const struct termios *termp,
+                const struct winsize *winp,
+                int* master,
+                pid_t* pid,
+                const char** failed);
 #endif
 
 #if defined(__APPLE__) || defined(__OpenBSD__)
@@ -243,75 +297,17 @@ pty_posix_spawn(char** argv, char** env,
                 int* err);
 #endif
 
-struct DelBuf {
-  int len;
-  DelBuf(int len) : len(len) {}
-  void operator()(char **p) {
-    if (p == nullptr)
-      return;
-    for (int i = 0; i < len; i++)
-      free(p[i]);
-    delete[] p;
-  }
-};
-
-Napi::Value PtyFork(const Napi::CallbackInfo& info) {
-  Napi::Env napiEnv(info.Env());
-  Napi::HandleScope scope(napiEnv);
-
-  if (info.Length() != 11 ||
-      !info[0].IsString() ||
-      !info[1].IsArray() ||
-      !info[2].IsArray() ||
-      !info[3].IsString() ||
-      !info[4].IsNumber() ||
-      !info[5].IsNumber() ||
-      !info[6].IsNumber() ||
-      !info[7].IsNumber() ||
-      !info[8].IsBoolean() ||
-      !info[9].IsString() ||
-      !info[10].IsFunction()) {
-    throw Napi::Error::New(napiEnv, "Usage: pty.fork(file, args, env, cwd, cols, rows, uid, gid, utf8, helperPath, onexit)");
-  }
-
-  // file
-  std::string file = info[0].As<Napi::String>();
-
-  // args
-  Napi::Array argv_ = info[1].As<Napi::Array>();
-
-  // env
-  Napi::Array env_ = info[2].As<Napi::Array>();
-  int envc = env_.Length();
-  std::unique_ptr<char *, DelBuf> env_unique_ptr(new char *[envc + 1], DelBuf(envc + 1));
-  char **env = env_unique_ptr.get();
-  env[envc] = NULL;
-  for (int i = 0; i < envc; i++) {
-    std::string pair = env_.Get(i).As<Napi::String>();
-    env[i] = strdup(pair.c_str());
-  }
-
-  // cwd
-  std::string cwd_ = info[3].As<Napi::String>();
-
-  // size
-  struct winsize winp;
-  winp.ws_col = info[4].As<Napi::Number>().Int32Value();
-  winp.ws_row = info[5].As<Napi::Number>().Int32Value();
-  winp.ws_xpixel = 0;
-  winp.ws_ypixel = 0;
+static const char kForkUsage[] =
+    "(file, args, env, envOverrides, cwd, cols, rows, uid, gid, utf8, helperPath, spawnMethod, onexit)";
 
-#if !defined(__APPLE__)
-  // uid / gid
-  int uid = info[6].As<Napi::Number>().Int32Value();
-  int gid = info[7].As<Napi::Number>().Int32Value();
-#endif
-
-  // termios
-  struct termios t = termios();
-  struct termios *term = &t;
+/**
+ * Sets the termios every child starts with.
+ */
+static void
+InitTermios(struct termios *term, bool utf8) {
+  *term = termios();
   term->c_iflag = ICRNL | IXON | IXANY | IMAXBEL | BRKINT;
-  if (info[8].As<Napi::Boolean>().Value()) {
+  if (utf8) {
 #if defined(IUTF8)
     term->c_iflag |= IUTF8;
 #endif
@@ -344,118 +340,477 @@ Napi::Value PtyFork(const Napi::CallbackInfo& info) {
 
   cfsetispeed(term, B38400);
   cfsetospeed(term, B38400);
+}
+
+static void
+CheckSpawnMethod(Napi::Env napiEnv, const std::string& method) {
+#if defined(__linux__)
+  if (method != "default" && method != "forkpty" && method != "zygote") {
+#else
+  if (method != "default") {
+#endif
+    throw Napi::Error::New(napiEnv, "Unsupported spawnMethod: " + method);
+  }
+}
+
+/**
+ * Parses the arguments shared by pty.fork and pty.forkAsync.
+ */
+static void
+ParseForkArgs(const Napi::CallbackInfo& info, const char *name, spawn::Request *request) {
+  Napi::Env napiEnv(info.Env());
+
+  if (info.Length() != 13 ||
+      !info[0].IsString() ||
+      !info[1].IsArray() ||
+      !info[2].IsObject() ||
+      !info[3].IsArray() ||
+      !info[4].IsString() ||
+      !info[5].IsNumber() ||
+      !info[6].IsNumber() ||
+      !info[7].IsNumber() ||
+      !info[8].IsNumber() ||
+      !info[9].IsBoolean() ||
+      !info[10].IsString() ||
+      !info[11].IsString() ||
+      !info[12].IsFunction()) {
+    throw Napi::Error::New(napiEnv, std::string("Usage: pty.") + name + kForkUsage);
+  }
+
+  // file
+  request->file = info[0].As<Napi::String>();
+
+  // args
+  Napi::Array argv_ = info[1].As<Napi::Array>();
+  for (uint32_t i = 0; i < argv_.Length(); i++) {
+    request->args.push_back(argv_.Get(i).As<Napi::String>());
+  }
+
+  // env
+  request->env = spawn::ParseEnv(napiEnv, info[2]);
+  Napi::Array overrides_ = info[3].As<Napi::Array>();
+  for (uint32_t i = 0; i < overrides_.Length(); i++) {
+    request->env_overrides.push_back(overrides_.Get(i).As<Napi::String>());
+  }
+
+  // cwd
+  request->cwd = info[4].As<Napi::String>();
+
+  // size
+  struct winsize *winp = &request->winp;
+  winp->ws_col = info[5].As<Napi::Number>().Int32Value();
+  winp->ws_row = info[6].As<Napi::Number>().Int32Value();
+  winp->ws_xpixel = 0;
+  winp->ws_ypixel = 0;
+
+#if !defined(__APPLE__)
+  // uid / gid
+  request->uid = info[7].As<Napi::Number>().Int32Value();
+  request->gid = info[8].As<Napi::Number>().Int32Value();
+#endif
+
+  // termios
+  InitTermios(&request->termp, info[9].As<Napi::Boolean>().Value());
 
   // helperPath
-  std::string helper_path = info[9].As<Napi::String>();
+  request->helper_path = info[10].As<Napi::String>();
+
+  // spawnMethod
+  request->method = info[11].As<Napi::String>();
+  CheckSpawnMethod(napiEnv, request->method);
+}
 
+/**
+ * Spawns the child of `request`. Does not touch JS and may run on any thread.
+ */
+static void
+pty_spawn(const spawn::Request& request, spawn::Result *result) {
   pid_t pid;
   int master;
+
+  std::vector<char *> env = spawn::EnvPointers(request);
+
+#if defined(__linux__)
+  if (request.method == "zygote") {
+    result->error = zygote::Spawn(request, &master, &pid);
+    if (!result->error.empty()) {
+      return;
+    }
+    result->external = true;
+  } else
+#endif
+  {
 #if defined(__APPLE__)
-  int argc = argv_.Length();
-  int argl = argc + 4;
-  std::unique_ptr<char *, DelBuf> argv_unique_ptr(new char *[argl], DelBuf(argl));
-  char **argv = argv_unique_ptr.get();
-  argv[0] = strdup(helper_path.c_str());
-  argv[1] = strdup(cwd_.c_str());
-  argv[2] = strdup(file.c_str());
-  argv[argl - 1] = NULL;
-  for (int i = 0; i < argc; i++) {
-    std::string arg = argv_.Get(i).As<Napi::String>();
-    argv[i + 3] = strdup(arg.c_str());
+  std::vector<char *> argv;
+  argv.push_back(const_cast<char *>(request.helper_path.c_str()));
+  argv.push_back(const_cast<char *>(request.cwd.c_str()));
+  argv.push_back(const_cast<char *>(request.file.c_str()));
+  for (const std::string& arg : request.args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
   }
+  argv.push_back(NULL);
 
   int err = -1;
-  pty_posix_spawn(argv, env, term, &winp, &master, &pid, &err);
+  pty_posix_spawn(argv.data(), env.data(), &request.termp, &request.winp, &master, &pid, &err);
   if (err != 0) {
-    throw Napi::Error::New(napiEnv, "posix_spawnp failed.");
-  }
-  if (pty_nonblock(master) == -1) {
-    throw Napi::Error::New(napiEnv, "Could not set master fd to nonblocking.");
+    result->error = "posix_spawnp failed.";
+    return;
   }
 #else
-  int argc = argv_.Length();
-  int argl = argc + 2;
-  std::unique_ptr<char *, DelBuf> argv_unique_ptr(new char *[argl], DelBuf(argl));
-  char** argv = argv_unique_ptr.get();
-  argv[0] = strdup(file.c_str());
-  argv[argl - 1] = NULL;
-  for (int i = 0; i < argc; i++) {
-    std::string arg = argv_.Get(i).As<Napi::String>();
-    argv[i + 1] = strdup(arg.c_str());
+  std::vector<char *> argv;
+  argv.push_back(const_cast<char *>(request.file.c_str()));
+  for (const std::string& arg : request.args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
   }
+  argv.push_back(NULL);
 
-  sigset_t newmask, oldmask;
-  struct sigaction sig_action;
-  // temporarily block all signals
-  // this is needed due to a race condition in openpty
-  // and to avoid running signal handlers in the child
-  // before exec* happened
-  sigfillset(&newmask);
-  pthread_sigmask(SIG_SETMASK, &newmask, &oldmask);
-
-  pid = forkpty(&master, nullptr, static_cast<termios*>(term), static_cast<winsize*>(&winp));
+#if defined(__linux__)
+  // forkpty(3) copies the page tables of the whole process, it is only kept
+  // around for comparison.
+  bool use_forkpty = request.method == "forkpty";
+#else
+  bool use_forkpty = true;
+#endif
 
-  if (!pid) {
-    // remove all signal handler from child
-    sig_action.sa_handler = SIG_DFL;
-    sig_action.sa_flags = 0;
-    sigemptyset(&sig_action.sa_mask);
-    for (int i = 0 ; i < NSIG ; i++) {    // NSIG is a macro for all signals + 1
-      sigaction(i, &sig_action, NULL);
+  if (!use_forkpty) {
+#if defined(__linux__)
+    const char *failed = "";
+    int err = pty_clone_spawn(argv.data(), env.data(), request.cwd.c_str(), request.uid, request.gid,
+                              &request.termp, &request.winp, &master, &pid, &failed);
+    if (err != 0) {
+      result->error = std::string(failed) + " failed: " + strerror(err);
+      return;
+    }
+#endif
+  } else {
+    sigset_t newmask, oldmask;
+    struct sigaction sig_action;
+    // temporarily block all signals
+    // this is needed due to a race condition in openpty
+    // and to avoid running signal handlers in the child
+    // before exec* happened
+    sigfillset(&newmask);
+    pthread_sigmask(SIG_SETMASK, &newmask, &oldmask);
+
+    struct termios termp = request.termp;
+    struct winsize winp = request.winp;
+    pid = forkpty(&master, nullptr, &termp, &winp);
+
+    if (!pid) {
+      // remove all signal handler from child
+      sig_action.sa_handler = SIG_DFL;
+      sig_action.sa_flags = 0;
+      sigemptyset(&sig_action.sa_mask);
+      for (int i = 0 ; i < NSIG ; i++) {    // NSIG is a macro for all signals + 1
+        sigaction(i, &sig_action, NULL);
+      }
     }
-  }
-
-  // reenable signals
-  pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 
-  switch (pid) {
-    case -1:
-      throw Napi::Error::New(napiEnv, "forkpty(3) failed.");
-    case 0:
-      if (strlen(cwd_.c_str())) {
-        if (chdir(cwd_.c_str()) == -1) {
-          perror("chdir(2) failed.");
-          _exit(1);
+    // reenable signals
+    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+    switch (pid) {
+      case -1:
+        result->error = "forkpty(3) failed.";
+        return;
+      case 0:
+        if (request.cwd.length()) {
+          if (chdir(request.cwd.c_str()) == -1) {
+            perror("chdir(2) failed.");
+            _exit(1);
+          }
         }
-      }
 
-      if (uid != -1 && gid != -1) {
-        if (setgid(gid) == -1) {
-          perror("setgid(2) failed.");
-          _exit(1);
+        if (request.uid != -1 && request.gid != -1) {
+          if (setgid(request.gid) == -1) {
+            perror("setgid(2) failed.");
+            _exit(1);
+          }
+          if (setuid(request.uid) == -1) {
+            perror("setuid(2) failed.");
+            _exit(1);
+          }
         }
-        if (setuid(uid) == -1) {
-          perror("setuid(2) failed.");
+
+        {
+          char **old = environ;
+          environ = env.data();
+          execvp(argv[0], argv.data());
+          environ = old;
+          perror("execvp(3) failed.");
           _exit(1);
         }
-      }
-
-      {
-        char **old = environ;
-        environ = env;
-        execvp(argv[0], argv);
-        environ = old;
-        perror("execvp(3) failed.");
-        _exit(1);
-      }
-    default:
-      if (pty_nonblock(master) == -1) {
-        throw Napi::Error::New(napiEnv, "Could not set master fd to nonblocking.");
-      }
+    }
   }
 #endif
+  }
+
+  if (pty_nonblock(master) == -1) {
+    result->error = "Could not set master fd to nonblocking.";
+    close(master);
+    // Nobody would watch the child, it is killed and reaped here. A child of
+    // the zygote is reaped by the zygote.
+    kill(pid, SIGKILL);
+    if (!result->external) {
+      while (waitpid(pid, NULL, 0) == -1 && errno == EINTR) {}
+    }
+    return;
+  }
+
+  result->master = master;
+  result->pid = pid;
+}
 
-  Napi::Object obj = Napi::Object::New(napiEnv);  
-  obj.Set("fd", Napi::Number::New(napiEnv, master));  
-  obj.Set("pid", Napi::Number::New(napiEnv, pid));  
-  obj.Set("pty", Napi::String::New(napiEnv, ptsname(master)));  
+/**
+ * Turns a successful `result` into the object returned to JS and starts
+ * watching the child for its exit.
+ */
+static Napi::Object
+ForkResult(Napi::Env napiEnv, const spawn::Result& result, Napi::Function onexit) {
+  Napi::Object obj = Napi::Object::New(napiEnv);
+  obj.Set("fd", Napi::Number::New(napiEnv, result.master));
+  obj.Set("pid", Napi::Number::New(napiEnv, result.pid));
+  obj.Set("pty", Napi::String::New(napiEnv, ptsname(result.master)));
 
   // Set up process exit callback.
-  Napi::Function cb = info[10].As<Napi::Function>();
-  SetupExitCallback(napiEnv, cb, pid);
+#if defined(__linux__)
+  if (result.external) {
+    // The child belongs to the zygote which relays its exit.
+    reaper::WatchExternal(napiEnv, onexit, result.pid);
+    return obj;
+  }
+#endif
+  SetupExitCallback(napiEnv, onexit, result.pid);
   return obj;
 }
 
+Napi::Value PtyFork(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  spawn::Request request;
+  ParseForkArgs(info, "fork", &request);
+
+  spawn::Result result;
+  pty_spawn(request, &result);
+  if (!result.error.empty()) {
+    throw Napi::Error::New(napiEnv, result.error);
+  }
+
+  return ForkResult(napiEnv, result, info[12].As<Napi::Function>());
+}
+
+/**
+ * Spawns on a thread of the libuv pool. The work is short, unlike the exit
+ * watchers above it does not occupy the thread for the lifetime of the child.
+ */
+class ForkWorker : public Napi::AsyncWorker {
+ public:
+  ForkWorker(Napi::Env env, spawn::Request&& request, Napi::Function onexit)
+      : Napi::AsyncWorker(env, "PtyForkAsync"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        request_(std::move(request)),
+        onexit_(Napi::Persistent(onexit)) {}
+
+  Napi::Promise Promise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    pty_spawn(request_, &result_);
+  }
+
+  void OnOK() override {
+    Napi::Env napiEnv = Env();
+    Napi::HandleScope scope(napiEnv);
+    if (!result_.error.empty()) {
+      deferred_.Reject(Napi::Error::New(napiEnv, result_.error).Value());
+      return;
+    }
+    deferred_.Resolve(ForkResult(napiEnv, result_, onexit_.Value()));
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  spawn::Request request_;
+  spawn::Result result_;
+  Napi::FunctionReference onexit_;
+};
+
+Napi::Value PtyForkAsync(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  spawn::Request request;
+  ParseForkArgs(info, "forkAsync", &request);
+
+  ForkWorker *worker = new ForkWorker(napiEnv, std::move(request), info[12].As<Napi::Function>());
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+static const char kForkManyUsage[] =
+    "Usage: pty.forkMany(envs, specs), each spec being {file, args, env, envOverrides, cwd, "
+    "cols, rows, uid, gid, utf8, helperPath, spawnMethod, onexit}";
+
+/**
+ * Parses one spec of pty.forkMany. It holds the pty.fork arguments, except for
+ * `env` which is the index of an already parsed environment.
+ */
+static void
+ParseForkSpec(Napi::Env napiEnv,
+              Napi::Value value,
+              const std::vector<spawn::EnvPairs>& envs,
+              const std::vector<std::string>& env_errors,
+              spawn::Request *request,
+              Napi::Function *onexit) {
+  if (!value.IsObject()) {
+    throw Napi::Error::New(napiEnv, kForkManyUsage);
+  }
+  Napi::Object spec = value.As<Napi::Object>();
+  Napi::Value file = spec.Get("file");
+  Napi::Value args = spec.Get("args");
+  Napi::Value env = spec.Get("env");
+  Napi::Value overrides = spec.Get("envOverrides");
+  Napi::Value cwd = spec.Get("cwd");
+  Napi::Value cols = spec.Get("cols");
+  Napi::Value rows = spec.Get("rows");
+  Napi::Value uid = spec.Get("uid");
+  Napi::Value gid = spec.Get("gid");
+  Napi::Value utf8 = spec.Get("utf8");
+  Napi::Value helperPath = spec.Get("helperPath");
+  Napi::Value spawnMethod = spec.Get("spawnMethod");
+  Napi::Value callback = spec.Get("onexit");
+  if (!file.IsString() ||
+      !args.IsArray() ||
+      !env.IsNumber() ||
+      !overrides.IsArray() ||
+      !cwd.IsString() ||
+      !cols.IsNumber() ||
+      !rows.IsNumber() ||
+      !uid.IsNumber() ||
+      !gid.IsNumber() ||
+      !utf8.IsBoolean() ||
+      !helperPath.IsString() ||
+      !spawnMethod.IsString() ||
+      !callback.IsFunction()) {
+    throw Napi::Error::New(napiEnv, kForkManyUsage);
+  }
+
+  request->file = file.As<Napi::String>();
+
+  Napi::Array argv_ = args.As<Napi::Array>();
+  for (uint32_t i = 0; i < argv_.Length(); i++) {
+    request->args.push_back(argv_.Get(i).As<Napi::String>());
+  }
+
+  uint32_t env_index = env.As<Napi::Number>().Uint32Value();
+  if (env_index >= envs.size()) {
+    throw Napi::Error::New(napiEnv, "Invalid env index.");
+  }
+  if (!env_errors[env_index].empty()) {
+    throw Napi::Error::New(napiEnv, env_errors[env_index]);
+  }
+  request->env = envs[env_index];
+  Napi::Array overrides_ = overrides.As<Napi::Array>();
+  for (uint32_t i = 0; i < overrides_.Length(); i++) {
+    request->env_overrides.push_back(overrides_.Get(i).As<Napi::String>());
+  }
+
+  request->cwd = cwd.As<Napi::String>();
+
+  request->winp.ws_col = cols.As<Napi::Number>().Int32Value();
+  request->winp.ws_row = rows.As<Napi::Number>().Int32Value();
+  request->winp.ws_xpixel = 0;
+  request->winp.ws_ypixel = 0;
+
+#if !defined(__APPLE__)
+  request->uid = uid.As<Napi::Number>().Int32Value();
+  request->gid = gid.As<Napi::Number>().Int32Value();
+#endif
+
+  InitTermios(&request->termp, utf8.As<Napi::Boolean>().Value());
+
+  request->helper_path = helperPath.As<Napi::String>();
+
+  request->method = spawnMethod.As<Napi::String>();
+  CheckSpawnMethod(napiEnv, request->method);
+
+  *onexit = callback.As<Napi::Function>();
+}
+
+/**
+ * Spawns every spec of `specs` in one call, returning for each either the
+ * object pty.fork returns or `{error}`. The environments in `envs`, arrays or
+ * EnvBlocks, are marshalled once however many specs share them.
+ */
+Napi::Value PtyForkMany(const Napi::CallbackInfo& info) {
+  Napi::Env napiEnv(info.Env());
+  Napi::HandleScope scope(napiEnv);
+
+  if (info.Length() != 2 ||
+      !info[0].IsArray() ||
+      !info[1].IsArray()) {
+    throw Napi::Error::New(napiEnv, kForkManyUsage);
+  }
+
+  Napi::Array envs_ = info[0].As<Napi::Array>();
+  std::vector<spawn::EnvPairs> envs(envs_.Length());
+  // An environment that can not be parsed only fails the specs using it
+  std::vector<std::string> env_errors(envs_.Length());
+  for (uint32_t i = 0; i < envs_.Length(); i++) {
+    try {
+      envs[i] = spawn::ParseEnv(napiEnv, envs_.Get(i));
+    } catch (const Napi::Error& e) {
+      env_errors[i] = e.Message();
+    }
+  }
+
+  Napi::Array specs = info[1].As<Napi::Array>();
+  Napi::Array results = Napi::Array::New(napiEnv, specs.Length());
+  for (uint32_t i = 0; i < specs.Length(); i++) {
+    spawn::Request request;
+    spawn::Result result;
+    Napi::Function onexit;
+    try {
+      ParseForkSpec(napiEnv, specs.Get(i), envs, env_errors, &request, &onexit);
+      pty_spawn(request, &result);
+    } catch (const Napi::Error& e) {
+      // One bad spec does not fail the others
+      result.error = e.Message();
+    }
+
+    if (!result.error.empty()) {
+      Napi::Object error = Napi::Object::New(napiEnv);
+      error.Set("error", Napi::String::New(napiEnv, result.error));
+      results.Set(i, error);
+      continue;
+    }
+    results.Set(i, ForkResult(napiEnv, result, onexit));
+  }
+  return results;
+}
+
+Napi::Value PtyStartZygote(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsString()) {
+    throw Napi::Error::New(env, "Usage: pty.startZygote(zygotePath)");
+  }
+
+#if defined(__linux__)
+  std::string error = zygote::Start(info[0].As<Napi::String>());
+  if (!error.empty()) {
+    throw Napi::Error::New(env, error);
+  }
+  return env.Undefined();
+#else
+  throw Napi::Error::New(env, "The spawn zygote is only supported on Linux.");
+#endif
+}
+
 Napi::Value PtyOpen(const Napi::CallbackInfo& info) {
   Napi::Env env(info.Env());
   Napi::HandleScope scope(env);
@@ -534,34 +889,128 @@ Napi::Value PtyResize(const Napi::CallbackInfo& info) {
 }
 
 /**
- * Foreground Process Name
+ * Input Queue
+ *
+ * The slave is opened once for all queries of a paste. While it is open the
+ * pty does not hang up when the child exits, so it must be closed once the
+ * child exited.
  */
-Napi::Value PtyGetProc(const Napi::CallbackInfo& info) {
+Napi::Value PtyOpenSlave(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsString()) {
+    throw Napi::Error::New(env, "Usage: pty.openSlave(tty)");
+  }
+
+  std::string tty = info[0].As<Napi::String>();
+  int fd = open(tty.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd == -1) {
+    throw Napi::Error::New(env, std::string("open(2) failed: ") + strerror(errno));
+  }
+  return Napi::Number::New(env, fd);
+}
+
+/**
+ * The number of bytes written to the master that the program has not read
+ * yet, queried through a slave fd from PtyOpenSlave. In canonical mode only
+ * complete lines are counted.
+ */
+Napi::Value PtyInputQueue(const Napi::CallbackInfo& info) {
   Napi::Env env(info.Env());
   Napi::HandleScope scope(env);
 
-#if defined(__APPLE__)
   if (info.Length() != 1 ||
       !info[0].IsNumber()) {
-    throw Napi::Error::New(env, "Usage: pty.process(pid)");
+    throw Napi::Error::New(env, "Usage: pty.inputQueue(slaveFd)");
   }
 
   int fd = info[0].As<Napi::Number>().Int32Value();
-  char *name = pty_getproc(fd);
-#else
+  int queued = 0;
+  if (ioctl(fd, FIONREAD, &queued) == -1) {
+    throw Napi::Error::New(env, std::string("ioctl(2) failed: ") + strerror(errno));
+  }
+  return Napi::Number::New(env, queued);
+}
+
+Napi::Value PtySetIoThreadPoolSize(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+
+  if (info.Length() != 1 ||
+      !info[0].IsNumber() ||
+      info[0].As<Napi::Number>().Int32Value() < 1) {
+    throw Napi::Error::New(env, "Usage: pty.setIoThreadPoolSize(size)");
+  }
+
+  channel::ThreadedChannel::SetPoolSize(info[0].As<Napi::Number>().Int32Value());
+  return env.Undefined();
+}
+
+/**
+ * Hands a pty over to another thread: its exit is no longer reported to this
+ * one and a duplicate of the master fd is returned, the original is closed
+ * with the stream reading it. The other thread takes over with PtyAdopt.
+ */
+Napi::Value PtyDetach(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
   if (info.Length() != 2 ||
       !info[0].IsNumber() ||
-      !info[1].IsString()) {
-    throw Napi::Error::New(env, "Usage: pty.process(fd, tty)");
+      !info[1].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.detach(fd, pid)");
   }
 
+#if defined(__linux__)
   int fd = info[0].As<Napi::Number>().Int32Value();
+  pid_t pid = info[1].As<Napi::Number>().Int32Value();
+  int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (copy == -1) {
+    throw Napi::Error::New(env, std::string("fcntl(2) failed: ") + strerror(errno));
+  }
+  if (!reaper::Detach(env, pid)) {
+    close(copy);
+    throw Napi::Error::New(env, "The process already exited.");
+  }
+  return Napi::Number::New(env, copy);
+#else
+  throw Napi::Error::New(env, "Transferring ptys is only supported on Linux.");
+#endif
+}
 
-  std::string tty_ = info[1].As<Napi::String>();
-  char *tty = strdup(tty_.c_str());
-  char *name = pty_getproc(fd, tty);
-  free(tty);
+Napi::Value PtyAdopt(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 2 ||
+      !info[0].IsNumber() ||
+      !info[1].IsFunction()) {
+    throw Napi::Error::New(env, "Usage: pty.adopt(pid, onexit)");
+  }
+
+#if defined(__linux__)
+  reaper::Adopt(env, info[1].As<Napi::Function>(), info[0].As<Napi::Number>().Int32Value());
+  return env.Undefined();
+#else
+  throw Napi::Error::New(env, "Transferring ptys is only supported on Linux.");
 #endif
+}
+
+/**
+ * Foreground Process Name
+ */
+Napi::Value PtyGetProc(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.process(fd)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+  char *name = pty_getproc(fd);
 
   if (name == NULL) {
     return env.Undefined();
@@ -572,6 +1021,116 @@ Napi::Value PtyGetProc(const Napi::CallbackInfo& info) {
   return name_;
 }
 
+/**
+ * Forget Process
+ * Drops what `process` and `processMany` keep for the pty, before its fd is
+ * closed and its number can be reused.
+ */
+Napi::Value PtyForgetProc(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.forgetProcess(fd)");
+  }
+
+  pty_forgetproc(info[0].As<Napi::Number>().Int32Value());
+  return env.Undefined();
+}
+
+/**
+ * Foreground Process Group, -1 if there is none
+ */
+Napi::Value PtyForegroundGroup(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsNumber()) {
+    throw Napi::Error::New(env, "Usage: pty.foregroundGroup(fd)");
+  }
+
+  int fd = info[0].As<Napi::Number>().Int32Value();
+  return Napi::Number::New(env, tcgetpgrp(fd));
+}
+
+/**
+ * Queries the foreground processes of many ptys on a thread of the libuv
+ * pool, so that polling all of them does not block the event loop.
+ */
+class ProcessManyWorker : public Napi::AsyncWorker {
+ public:
+  ProcessManyWorker(Napi::Env env, std::vector<int>&& fds)
+      : Napi::AsyncWorker(env, "PtyProcessMany"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        fds_(std::move(fds)),
+        processes_(fds_.size()) {}
+
+  Napi::Promise Promise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    for (size_t i = 0; i < fds_.size(); i++) {
+      pty_getforeground(fds_[i], &processes_[i]);
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+    Napi::Array results = Napi::Array::New(env, processes_.size());
+    for (size_t i = 0; i < processes_.size(); i++) {
+      const ForegroundProcess &process = processes_[i];
+      if (!process.found) {
+        results.Set(i, env.Null());
+        continue;
+      }
+      Napi::Array argv = Napi::Array::New(env, process.argv.size());
+      for (size_t j = 0; j < process.argv.size(); j++) {
+        argv.Set(j, Napi::String::New(env, process.argv[j]));
+      }
+      Napi::Object result = Napi::Object::New(env);
+      result.Set("pgrp", Napi::Number::New(env, process.pgrp));
+      result.Set("name", Napi::String::New(env, process.name));
+      result.Set("argv", argv);
+      results.Set(i, result);
+    }
+    deferred_.Resolve(results);
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  std::vector<int> fds_;
+  std::vector<ForegroundProcess> processes_;
+};
+
+Napi::Value PtyProcessMany(const Napi::CallbackInfo& info) {
+  Napi::Env env(info.Env());
+  Napi::HandleScope scope(env);
+
+  if (info.Length() != 1 ||
+      !info[0].IsArray()) {
+    throw Napi::Error::New(env, "Usage: pty.processMany(fds)");
+  }
+
+  Napi::Array array = info[0].As<Napi::Array>();
+  std::vector<int> fds;
+  fds.reserve(array.Length());
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value fd = array.Get(i);
+    if (!fd.IsNumber()) {
+      throw Napi::Error::New(env, "Usage: pty.processMany(fds)");
+    }
+    fds.push_back(fd.As<Napi::Number>().Int32Value());
+  }
+
+  ProcessManyWorker *worker = new ProcessManyWorker(env, std::move(fds));
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
 /**
  * Nonblocking FD
  */
@@ -607,44 +1166,117 @@ pty_nonblock(int fd) {
 
 #if defined(__linux__)
 
-static char *
-pty_getproc(int fd, char *tty) {
-  FILE *f;
-  char *path, *buf;
-  size_t len;
-  int ch;
+/**
+ * The /proc/<pgrp>/cmdline handle last opened for each pty master fd. It is
+ * kept while the foreground process group stays the same, so that a query
+ * only costs a tcgetpgrp and a pread. An open handle stays bound to the
+ * process it was opened for: it follows that process through exec, and
+ * reading it fails once the process is gone, even if its id was reused.
+ * Entries are dropped by pty_forgetproc when the pty is closed, `ptn` guards
+ * against a master fd number that was reused before that.
+ */
+struct ProcHandle {
+  unsigned int ptn;
   pid_t pgrp;
-  int r;
+  int fd;
+};
 
-  if ((pgrp = tcgetpgrp(fd)) == -1) {
-    return NULL;
+static std::mutex proc_handles_mutex;
+static std::unordered_map<int, ProcHandle> proc_handles;
+
+/**
+ * Reads the command line of the foreground process group of `fd`, only its
+ * first 4 KiB unless `full`. Returns false if there is none.
+ */
+static bool
+pty_read_cmdline(int fd, bool full, pid_t *pgrp_, std::string *cmdline) {
+  pid_t pgrp = tcgetpgrp(fd);
+  unsigned int ptn;
+  if (pgrp == -1 || ioctl(fd, TIOCGPTN, &ptn) == -1) {
+    pty_forgetproc(fd);
+    return false;
   }
 
-  r = asprintf(&path, "/proc/%lld/cmdline", (long long)pgrp);
-  if (r == -1 || path == NULL) return NULL;
+  std::lock_guard<std::mutex> lock(proc_handles_mutex);
+  auto it = proc_handles.find(fd);
+  if (it == proc_handles.end()) {
+    it = proc_handles.insert({fd, ProcHandle{ptn, pgrp, -1}}).first;
+  }
+  ProcHandle &handle = it->second;
+  if (handle.ptn != ptn) {
+    // The fd number now belongs to another pty.
+    if (handle.fd != -1) close(handle.fd);
+    handle = ProcHandle{ptn, pgrp, -1};
+  }
 
-  if ((f = fopen(path, "r")) == NULL) {
-    free(path);
-    return NULL;
+  char buf[4096];
+  ssize_t len = -1;
+  if (handle.fd != -1 && handle.pgrp == pgrp) {
+    len = pread(handle.fd, buf, sizeof(buf), 0);
+  }
+  if (len <= 0) {
+    // The group changed, or its leader is gone.
+    if (handle.fd != -1) close(handle.fd);
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%lld/cmdline", (long long)pgrp);
+    handle.pgrp = pgrp;
+    handle.fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (handle.fd == -1) {
+      return false;
+    }
+    len = pread(handle.fd, buf, sizeof(buf), 0);
+    if (len <= 0) {
+      return false;
+    }
   }
 
-  free(path);
+  *pgrp_ = pgrp;
+  cmdline->assign(buf, len);
+  while (full && len == sizeof(buf)) {
+    len = pread(handle.fd, buf, sizeof(buf), cmdline->size());
+    if (len <= 0) break;
+    cmdline->append(buf, len);
+  }
+  return true;
+}
 
-  len = 0;
-  buf = NULL;
-  while ((ch = fgetc(f)) != EOF) {
-    if (ch == '\0') break;
-    buf = (char *)realloc(buf, len + 2);
-    if (buf == NULL) return NULL;
-    buf[len++] = ch;
+static void
+pty_forgetproc(int fd) {
+  std::lock_guard<std::mutex> lock(proc_handles_mutex);
+  auto it = proc_handles.find(fd);
+  if (it != proc_handles.end()) {
+    if (it->second.fd != -1) close(it->second.fd);
+    proc_handles.erase(it);
   }
+}
 
-  if (buf != NULL) {
-    buf[len] = '\0';
+static char *
+pty_getproc(int fd) {
+  pid_t pgrp;
+  std::string cmdline;
+  // argv[0] is all that is used, longer names are cut.
+  if (!pty_read_cmdline(fd, false, &pgrp, &cmdline) || cmdline[0] == '\0') {
+    return NULL;
   }
+  return strdup(cmdline.c_str());
+}
 
-  fclose(f);
-  return buf;
+static void
+pty_getforeground(int fd, ForegroundProcess *process) {
+  std::string cmdline;
+  if (!pty_read_cmdline(fd, true, &process->pgrp, &cmdline)) {
+    return;
+  }
+  // Arguments are terminated by NULs, the last one as well.
+  size_t start = 0;
+  while (start < cmdline.size()) {
+    size_t end = cmdline.find('\0', start);
+    if (end == std::string::npos) end = cmdline.size();
+    process->argv.push_back(cmdline.substr(start, end - start));
+    start = end + 1;
+  }
+  process->found = true;
+  process->name = process->argv.empty() ? std::string() : process->argv[0];
 }
 
 #elif defined(__APPLE__)
@@ -671,13 +1303,252 @@ pty_getproc(int fd) {
   return strdup(kp.kp_proc.p_comm);
 }
 
+static void
+pty_forgetproc(int fd) {
+}
+
+static void
+pty_getforeground(int fd, ForegroundProcess *process) {
+  int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, 0 };
+  size_t size;
+  struct kinfo_proc kp;
+
+  if ((mib[3] = tcgetpgrp(fd)) == -1) {
+    return;
+  }
+
+  size = sizeof kp;
+  if (sysctl(mib, 4, &kp, &size, NULL, 0) == -1 || size != (sizeof kp)) {
+    return;
+  }
+  process->found = true;
+  process->pgrp = mib[3];
+  process->name = kp.kp_proc.p_comm;
+
+  // KERN_PROCARGS2 is argc, the executable path, NUL padding, then argv.
+  int args_mib[3] = { CTL_KERN, KERN_PROCARGS2, mib[3] };
+  int argmax_mib[2] = { CTL_KERN, KERN_ARGMAX };
+  int argmax;
+  size = sizeof argmax;
+  if (sysctl(argmax_mib, 2, &argmax, &size, NULL, 0) == -1) {
+    return;
+  }
+  std::vector<char> args(argmax);
+  size = args.size();
+  int argc;
+  if (sysctl(args_mib, 3, args.data(), &size, NULL, 0) == -1 || size < sizeof argc) {
+    // Not permitted for processes of other users.
+    return;
+  }
+  memcpy(&argc, args.data(), sizeof argc);
+  const char *p = args.data() + sizeof argc;
+  const char *end = args.data() + size;
+  p = static_cast<const char *>(memchr(p, '\0', end - p));
+  while (p != NULL && p < end && *p == '\0') p++;
+  for (int i = 0; p != NULL && p < end && i < argc; i++) {
+    const char *next = static_cast<const char *>(memchr(p, '\0', end - p));
+    if (next == NULL) break;
+    process->argv.push_back(std::string(p, next - p));
+    p = next + 1;
+  }
+}
+
 #else
 
 static char *
-pty_getproc(int fd, char *tty) {
+pty_getproc(int fd) {
   return NULL;
 }
 
+static void
+pty_forgetproc(int fd) {
+}
+
+static void
+pty_getforeground(int fd, ForegroundProcess *process) {
+}
+
+#endif
+
+#if defined(__linux__)
+/**
+ * pty_clone_spawn
+ * Starts the child with clone(CLONE_VM | CLONE_VFORK), the way glibc's
+ * posix_spawn(3) does. The child borrows the address space of the parent
+ * until it called exec, so unlike forkpty(3) nothing is copied, however large
+ * the Node heap is. posix_spawn(3) itself can not be used as it has no way to
+ * make the pty the controlling terminal of the child.
+ */
+
+// Stack of the child, it only runs until exec.
+#define PTY_CLONE_STACK_SIZE (256 * 1024)
+
+struct pty_clone_args {
+  char **argv;
+  char **env;
+  const char *cwd;
+  int uid;
+  int gid;
+  int slave;
+  const sigset_t *sigmask;
+};
+
+// Reports a failed step of the child and exits. The child shares the memory
+// of the parent, so only async-signal-safe calls are made: no stdio, whose
+// locks and buffers belong to the parent.
+[[noreturn]] static void
+pty_clone_child_fail(const char *message) {
+  ssize_t ignored = write(STDERR_FILENO, message, strlen(message));
+  (void)ignored;
+  _exit(1);
+}
+
+static int
+pty_clone_child(void *arg) {
+  const pty_clone_args *args = static_cast<const pty_clone_args *>(arg);
+
+  // remove all signal handler from child, without CLONE_SIGHAND they are not
+  // shared with the parent
+  struct sigaction sig_action;
+  sig_action.sa_handler = SIG_DFL;
+  sig_action.sa_flags = 0;
+  sigemptyset(&sig_action.sa_mask);
+  for (int i = 0 ; i < NSIG ; i++) {    // NSIG is a macro for all signals + 1
+    sigaction(i, &sig_action, NULL);
+  }
+  sigprocmask(SIG_SETMASK, args->sigmask, NULL);
+
+  // What forkpty(3) does through login_tty(3).
+  if (setsid() == -1 || ioctl(args->slave, TIOCSCTTY, 0) == -1) {
+    _exit(1);
+  }
+  if (dup2(args->slave, STDIN_FILENO) == -1 ||
+      dup2(args->slave, STDOUT_FILENO) == -1 ||
+      dup2(args->slave, STDERR_FILENO) == -1) {
+    _exit(1);
+  }
+
+  if (strlen(args->cwd)) {
+    if (chdir(args->cwd) == -1) {
+      pty_clone_child_fail("chdir(2) failed.\n");
+    }
+  }
+
+  if (args->uid != -1 && args->gid != -1) {
+    // glibc's setgid(2) and setuid(2) apply the change to every thread of the
+    // process, which would be the threads of the parent whose memory we
+    // share. The raw system calls only affect this process.
+    if (syscall(SYS_setgid, args->gid) == -1) {
+      pty_clone_child_fail("setgid(2) failed.\n");
+    }
+    if (syscall(SYS_setuid, args->uid) == -1) {
+      pty_clone_child_fail("setuid(2) failed.\n");
+    }
+  }
+
+  execvpe(args->argv[0], args->argv, args->env);
+  pty_clone_child_fail("execvp(3) failed.\n");
+}
+
+static int
+pty_clone_spawn(char** argv, char** env,
+                const char* cwd, int uid, int gid,
+                const struct termios *termp,
+                const struct winsize *winp,
+                int* master,
+                pid_t* pid,
+                const char** failed) {
+  int err = 0;
+  int slave = -1;
+  char slave_pty_name[128];
+  char *stack = static_cast<char *>(MAP_FAILED);
+  sigset_t newmask, oldmask;
+  pty_clone_args args;
+
+  *master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (*master == -1) {
+    *failed = "posix_openpt(3)";
+    return errno;
+  }
+
+  if (grantpt(*master) == -1 || unlockpt(*master) == -1) {
+    *failed = "unlockpt(3)";
+    err = errno;
+    goto done;
+  }
+
+  // ptsname_r(3) as this may run on several threads.
+  err = ptsname_r(*master, slave_pty_name, sizeof(slave_pty_name));
+  if (err != 0) {
+    *failed = "ptsname_r(3)";
+    goto done;
+  }
+
+  slave = open(slave_pty_name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (slave == -1) {
+    *failed = "open(2) of the pty slave";
+    err = errno;
+    goto done;
+  }
+
+  if (tcsetattr(slave, TCSANOW, termp) == -1) {
+    *failed = "tcsetattr(3)";
+    err = errno;
+    goto done;
+  }
+
+  if (ioctl(slave, TIOCSWINSZ, winp) == -1) {
+    *failed = "ioctl(2) TIOCSWINSZ";
+    err = errno;
+    goto done;
+  }
+
+  stack = static_cast<char *>(mmap(NULL, PTY_CLONE_STACK_SIZE, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0));
+  if (stack == MAP_FAILED) {
+    *failed = "mmap(2)";
+    err = errno;
+    goto done;
+  }
+
+  args.argv = argv;
+  args.env = env;
+  args.cwd = cwd;
+  args.uid = uid;
+  args.gid = gid;
+  args.slave = slave;
+  args.sigmask = &oldmask;
+
+  // temporarily block all signals
+  // this avoids running signal handlers of the parent in the child before
+  // they were reset
+  sigfillset(&newmask);
+  pthread_sigmask(SIG_SETMASK, &newmask, &oldmask);
+
+  // Returns once the child called exec or exited.
+  *pid = clone(pty_clone_child, stack + PTY_CLONE_STACK_SIZE,
+               CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+  if (*pid == -1) {
+    *failed = "clone(2)";
+    err = errno;
+  }
+
+  // reenable signals
+  pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+done:
+  if (stack != MAP_FAILED) {
+    munmap(stack, PTY_CLONE_STACK_SIZE);
+  }
+  if (slave != -1) {
+    close(slave);
+  }
+  if (err != 0) {
+    close(*master);
+    *master = -1;
+  }
+  return err;
+}
 #endif
 
 #if defined(__APPLE__)
@@ -787,9 +1658,22 @@ done:
 
 Napi::Object init(Napi::Env env, Napi::Object exports) {
   exports.Set("fork",    Napi::Function::New(env, PtyFork));
+  exports.Set("forkAsync", Napi::Function::New(env, PtyForkAsync));
+  exports.Set("forkMany", Napi::Function::New(env, PtyForkMany));
+  exports.Set("startZygote", Napi::Function::New(env, PtyStartZygote));
   exports.Set("open",    Napi::Function::New(env, PtyOpen));
   exports.Set("resize",  Napi::Function::New(env, PtyResize));
+  exports.Set("openSlave", Napi::Function::New(env, PtyOpenSlave));
+  exports.Set("inputQueue", Napi::Function::New(env, PtyInputQueue));
+  exports.Set("setIoThreadPoolSize", Napi::Function::New(env, PtySetIoThreadPoolSize));
+  exports.Set("detach",  Napi::Function::New(env, PtyDetach));
+  exports.Set("adopt",   Napi::Function::New(env, PtyAdopt));
   exports.Set("process", Napi::Function::New(env, PtyGetProc));
+  exports.Set("forgetProcess", Napi::Function::New(env, PtyForgetProc));
+  exports.Set("processMany", Napi::Function::New(env, PtyProcessMany));
+  exports.Set("foregroundGroup", Napi::Function::New(env, PtyForegroundGroup));
+  exports.Set("Channel", channel::ChannelWrap::Init(env));
+  exports.Set("EnvBlock", spawn::EnvBlock::Init(env));
   return exports;
 }
 
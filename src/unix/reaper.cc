@@ -0,0 +1,667 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * reaper.cc:
+ *   Watches every pty child of the process from a single thread.
+ *
+ *   Each child is represented by a pidfd (Linux 5.3+) registered with one
+ *   epoll instance. A pidfd becomes readable once the child can be reaped
+ *   with waitpid(2). Kernels without pidfd_open fall back to polling the
+ *   watched pids with WNOHANG from the same thread.
+ *
+ *   Ptys spawned by the zygote are children of the zygote, their exits are
+ *   relayed over a socket that is watched by the same epoll instance.
+ *
+ * See:
+ *   man pidfd_open
+ *   man epoll
+ */
+
+#if defined(__linux__)
+
+#include "reaper.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+namespace reaper {
+
+namespace {
+
+// How often children without a pidfd are polled.
+const int kSweepIntervalMs = 100;
+
+// Upper bound of exits handled per epoll_wait(2) wakeup.
+const int kMaxEvents = 64;
+
+// Tags the epoll data of fds passed to WatchFd, pids never reach this bit.
+const uint64_t kFdTag = 1ull << 32;
+
+struct ExitEvent {
+  pid_t pid = 0;
+  int exit_code = 0, signal_code = 0;
+};
+
+typedef std::vector<ExitEvent> ExitBatch;
+
+ExitEvent ToExitEvent(pid_t pid, int stat_loc) {
+  ExitEvent event;
+  event.pid = pid;
+  if (WIFEXITED(stat_loc)) {
+    event.exit_code = WEXITSTATUS(stat_loc);
+  }
+  if (WIFSIGNALED(stat_loc)) {
+    event.signal_code = WTERMSIG(stat_loc);
+  }
+  return event;
+}
+
+/**
+ * Per environment (main thread or worker) end of the reaper. Owns the JS exit
+ * callbacks of the environment and a single ThreadSafeFunction the reaper
+ * thread posts batches to.
+ */
+class Sink {
+ public:
+  explicit Sink(Napi::Env env);
+
+  // JS thread.
+  void Add(Napi::Env env, pid_t pid, Napi::Function cb);
+  // Drops the callback of `pid`, returns false if there was none.
+  bool Remove(Napi::Env env, pid_t pid);
+  // Hands the exit of `pid`, which is already on its way, back to the reaper.
+  void Forward(pid_t pid);
+  void Dispatch(Napi::Env env, ExitBatch *batch);
+  void Close();
+
+  // Reaper thread.
+  void Post(ExitBatch *batch);
+
+ private:
+  Napi::ThreadSafeFunction tsfn_;
+  std::unordered_map<pid_t, Napi::FunctionReference> callbacks_;
+  std::unordered_set<pid_t> detached_;
+};
+
+struct Entry {
+  int pidfd = -1;
+  Sink *sink = nullptr;
+  // Not our child, reported through Deliver.
+  bool external = false;
+  // Passed to Detach and not adopted yet, its exit is held.
+  bool detached = false;
+  // Passed to Expect and not to WatchExternal yet, its exit goes to
+  // `unclaimed_`.
+  bool pending = false;
+  // The response of the zygote that announced it, see zygote_protocol.h.
+  uint32_t serial = 0;
+};
+
+struct UnclaimedExit {
+  ExitEvent event;
+  uint32_t serial = 0;
+};
+
+class Reaper {
+ public:
+  static Reaper *Get();
+
+  void Watch(pid_t pid, Sink *sink);
+  void WatchExternal(pid_t pid, Sink *sink);
+  void Expect(pid_t pid, uint32_t serial);
+  void Deliver(pid_t pid, int status, uint32_t serial);
+  void Orphan();
+  bool Detach(pid_t pid);
+  void Adopt(pid_t pid, Sink *sink);
+  void Hold(const ExitEvent &event);
+  void WatchFd(int fd, FdHandler handler);
+  void UnwatchFd(int fd);
+  void Forget(Sink *sink);
+
+ private:
+  Reaper();
+  void Run();
+  void Sweep(std::unordered_map<Sink *, ExitBatch> *batches);
+  bool TryReap(pid_t pid, ExitEvent *event);
+  bool AddPidfd(pid_t pid, Entry *entry);
+  void Remove(std::unordered_map<pid_t, Entry>::iterator it);
+  void Report(const Entry &entry, const ExitEvent &event, std::unordered_map<Sink *, ExitBatch> *batches);
+  void HoldLocked(const ExitEvent &event);
+  // Drops what is held for an earlier process with the pid of a new entry.
+  void DropHeldLocked(pid_t pid);
+
+  std::mutex mutex_;
+  int epfd_ = -1;
+  int wakefd_ = -1;
+  bool has_pidfd_ = false;
+  size_t unwatchable_ = 0;
+  std::unordered_map<pid_t, Entry> entries_;
+  // External exits delivered before their pid was watched. Dropped by Expect
+  // once the pid belongs to a new process, and by Orphan.
+  std::unordered_map<pid_t, UnclaimedExit> unclaimed_;
+  // Exits of detached pids, and environments waiting for exits that were
+  // detached on their way to JS.
+  std::unordered_map<pid_t, ExitEvent> held_;
+  std::unordered_map<pid_t, Sink *> adopters_;
+  std::unordered_map<int, FdHandler> fds_;
+};
+
+std::mutex sinks_mutex;
+std::unordered_map<napi_env, Sink *> sinks;
+
+Sink::Sink(Napi::Env env) {
+  // The JS function is unused, callbacks are looked up per pid in Dispatch.
+  Napi::Function noop = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+  tsfn_ = Napi::ThreadSafeFunction::New(
+      env,
+      noop,
+      "reaper_resource",
+      0,  // Unlimited queue
+      1); // Only the reaper thread uses it
+  // Only keep the event loop alive while there are children to wait for.
+  tsfn_.Unref(env);
+}
+
+void Sink::Add(Napi::Env env, pid_t pid, Napi::Function cb) {
+  if (callbacks_.empty()) {
+    tsfn_.Ref(env);
+  }
+  callbacks_[pid] = Napi::Persistent(cb);
+}
+
+bool Sink::Remove(Napi::Env env, pid_t pid) {
+  if (callbacks_.erase(pid) == 0) {
+    return false;
+  }
+  if (callbacks_.empty()) {
+    tsfn_.Unref(env);
+  }
+  return true;
+}
+
+void Sink::Forward(pid_t pid) {
+  detached_.insert(pid);
+}
+
+void Sink::Post(ExitBatch *batch) {
+  auto status = tsfn_.NonBlockingCall(batch, [this](Napi::Env env, Napi::Function, ExitBatch *batch) {
+    Dispatch(env, batch);
+  });
+  if (status != napi_ok) {
+    // The environment is shutting down.
+    delete batch;
+  }
+}
+
+void Sink::Dispatch(Napi::Env env, ExitBatch *batch) {
+  std::unique_ptr<ExitBatch> events(batch);
+  Napi::Error error;
+  for (const ExitEvent &event : *events) {
+    auto it = callbacks_.find(event.pid);
+    if (it == callbacks_.end()) {
+      if (detached_.erase(event.pid) != 0) {
+        Reaper::Get()->Hold(event);
+      }
+      continue;
+    }
+    Napi::FunctionReference cb = std::move(it->second);
+    callbacks_.erase(it);
+    try {
+      cb.Call({Napi::Number::New(env, event.exit_code),
+               Napi::Number::New(env, event.signal_code)});
+    } catch (const Napi::Error &e) {
+      // Deliver the rest of the batch before surfacing the first exception.
+      if (error.IsEmpty()) {
+        error = e;
+      }
+    }
+  }
+  if (callbacks_.empty()) {
+    tsfn_.Unref(env);
+  }
+  if (!error.IsEmpty()) {
+    throw error;
+  }
+}
+
+void Sink::Close() {
+  callbacks_.clear();
+  tsfn_.Release();
+}
+
+void CleanupSink(void *arg) {
+  Sink *sink = static_cast<Sink *>(arg);
+  {
+    std::lock_guard<std::mutex> lock(sinks_mutex);
+    for (auto it = sinks.begin(); it != sinks.end(); ++it) {
+      if (it->second == sink) {
+        sinks.erase(it);
+        break;
+      }
+    }
+  }
+  // Children of a torn down environment are still reaped, just not reported.
+  Reaper::Get()->Forget(sink);
+  sink->Close();
+  delete sink;
+}
+
+Sink *GetSink(Napi::Env env) {
+  std::lock_guard<std::mutex> lock(sinks_mutex);
+  auto it = sinks.find(env);
+  if (it != sinks.end()) {
+    return it->second;
+  }
+  Sink *sink = new Sink(env);
+  sinks[env] = sink;
+  napi_add_env_cleanup_hook(env, CleanupSink, sink);
+  return sink;
+}
+
+Reaper *Reaper::Get() {
+  // Intentionally leaked, the thread lives as long as the process.
+  static Reaper *instance = new Reaper();
+  return instance;
+}
+
+Reaper::Reaper() {
+  epfd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakefd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (epfd_ == -1 || wakefd_ == -1) {
+    Napi::Error::Fatal("reaper", "Could not create epoll instance");
+  }
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = 0;  // pid 0 is never watched
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+
+  int probe = syscall(__NR_pidfd_open, getpid(), 0);
+  if (probe != -1) {
+    has_pidfd_ = true;
+    close(probe);
+  }
+
+  std::thread(&Reaper::Run, this).detach();
+}
+
+bool Reaper::AddPidfd(pid_t pid, Entry *entry) {
+  if (!has_pidfd_) {
+    return false;
+  }
+  entry->pidfd = syscall(__NR_pidfd_open, pid, 0);
+  if (entry->pidfd == -1) {
+    return false;
+  }
+  // pidfds are always close-on-exec.
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = static_cast<uint64_t>(pid);
+  if (epoll_ctl(epfd_, EPOLL_CTL_ADD, entry->pidfd, &ev) == -1) {
+    close(entry->pidfd);
+    entry->pidfd = -1;
+    return false;
+  }
+  return true;
+}
+
+void Reaper::Watch(pid_t pid, Sink *sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry entry;
+  entry.sink = sink;
+  if (!AddPidfd(pid, &entry) && unwatchable_++ == 0) {
+    // Wake the thread so it starts sweeping.
+    uint64_t one = 1;
+    if (write(wakefd_, &one, sizeof(one)) == -1) {}
+  }
+  DropHeldLocked(pid);
+  entries_[pid] = entry;
+}
+
+void Reaper::WatchExternal(pid_t pid, Sink *sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto unclaimed = unclaimed_.find(pid);
+  if (unclaimed != unclaimed_.end()) {
+    sink->Post(new ExitBatch(1, unclaimed->second.event));
+    unclaimed_.erase(unclaimed);
+    return;
+  }
+  auto it = entries_.find(pid);
+  if (it != entries_.end() && it->second.pending) {
+    it->second.sink = sink;
+    it->second.pending = false;
+    return;
+  }
+  // Its exit was dropped with the zygote that spawned it, see Orphan.
+  sink->Post(new ExitBatch(1, ToExitEvent(pid, 0)));
+}
+
+void Reaper::Expect(pid_t pid, uint32_t serial) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto unclaimed = unclaimed_.find(pid);
+  if (unclaimed != unclaimed_.end()) {
+    if (unclaimed->second.serial >= serial) {
+      // Exited already, WatchExternal picks it up.
+      return;
+    }
+    unclaimed_.erase(unclaimed);
+  }
+  auto it = entries_.find(pid);
+  if (it != entries_.end()) {
+    Remove(it);
+  }
+  Entry entry;
+  entry.external = true;
+  entry.pending = true;
+  entry.serial = serial;
+  DropHeldLocked(pid);
+  entries_[pid] = entry;
+}
+
+void Reaper::Deliver(pid_t pid, int status, uint32_t serial) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(pid);
+  if (it == entries_.end() || !it->second.external) {
+    // Not announced yet, or never, such as a child whose spawn failed after
+    // the fork.
+    UnclaimedExit &unclaimed = unclaimed_[pid];
+    unclaimed.event = ToExitEvent(pid, status);
+    unclaimed.serial = serial;
+    return;
+  }
+  if (serial < it->second.serial) {
+    // An earlier process with the same pid.
+    return;
+  }
+  std::unordered_map<Sink *, ExitBatch> batches;
+  Report(it->second, ToExitEvent(pid, status), &batches);
+  for (auto &batch : batches) {
+    batch.first->Post(new ExitBatch(std::move(batch.second)));
+  }
+  Remove(it);
+}
+
+void Reaper::Orphan() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Serial numbers start over with the next zygote, WatchExternal reports
+  // these as 0.
+  unclaimed_.clear();
+  std::unordered_map<Sink *, ExitBatch> batches;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto current = it++;
+    if (!current->second.external) {
+      continue;
+    }
+    current->second.external = false;
+    // The pidfd becomes readable on exit, waitpid(2) then fails with ECHILD
+    // which TryReap reports as a clean exit.
+    if (!AddPidfd(current->first, &current->second)) {
+      Report(current->second, ToExitEvent(current->first, 0), &batches);
+      entries_.erase(current);
+    }
+  }
+  for (auto &it : batches) {
+    it.first->Post(new ExitBatch(std::move(it.second)));
+  }
+}
+
+void Reaper::WatchFd(int fd, FdHandler handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = kFdTag | static_cast<uint64_t>(fd);
+  if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+    Napi::Error::Fatal("reaper", "Could not watch fd");
+  }
+  fds_[fd] = handler;
+}
+
+void Reaper::UnwatchFd(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+  fds_.erase(fd);
+}
+
+bool Reaper::Detach(pid_t pid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(pid);
+  if (it == entries_.end()) {
+    return false;
+  }
+  it->second.sink = nullptr;
+  it->second.detached = true;
+  return true;
+}
+
+void Reaper::Adopt(pid_t pid, Sink *sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A detached process that is still running comes first, anything held for
+  // its pid is of an earlier one.
+  auto it = entries_.find(pid);
+  if (it != entries_.end() && it->second.detached) {
+    it->second.sink = sink;
+    it->second.detached = false;
+    return;
+  }
+  auto held = held_.find(pid);
+  if (held != held_.end()) {
+    sink->Post(new ExitBatch(1, held->second));
+    held_.erase(held);
+    return;
+  }
+  // The exit is on its way to the environment it was detached from, which
+  // hands it back through Hold.
+  adopters_[pid] = sink;
+}
+
+void Reaper::Hold(const ExitEvent &event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  HoldLocked(event);
+}
+
+void Reaper::HoldLocked(const ExitEvent &event) {
+  auto adopter = adopters_.find(event.pid);
+  if (adopter != adopters_.end()) {
+    adopter->second->Post(new ExitBatch(1, event));
+    adopters_.erase(adopter);
+    return;
+  }
+  held_[event.pid] = event;
+}
+
+void Reaper::DropHeldLocked(pid_t pid) {
+  held_.erase(pid);
+  adopters_.erase(pid);
+}
+
+void Reaper::Report(const Entry &entry, const ExitEvent &event, std::unordered_map<Sink *, ExitBatch> *batches) {
+  if (entry.detached) {
+    HoldLocked(event);
+  } else if (entry.sink) {
+    (*batches)[entry.sink].push_back(event);
+  } else if (entry.pending) {
+    unclaimed_[event.pid].event = event;
+  }
+}
+
+void Reaper::Forget(Sink *sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &it : entries_) {
+    if (it.second.sink == sink) {
+      it.second.sink = nullptr;
+    }
+  }
+  for (auto it = adopters_.begin(); it != adopters_.end();) {
+    auto current = it++;
+    if (current->second == sink) {
+      adopters_.erase(current);
+    }
+  }
+}
+
+void Reaper::Remove(std::unordered_map<pid_t, Entry>::iterator it) {
+  if (it->second.pidfd != -1) {
+    // Closing the last reference also removes it from the epoll set.
+    close(it->second.pidfd);
+  } else if (!it->second.external) {
+    unwatchable_--;
+  }
+  entries_.erase(it);
+}
+
+bool Reaper::TryReap(pid_t pid, ExitEvent *event) {
+  int ret;
+  int stat_loc = 0;
+  do {
+    ret = waitpid(pid, &stat_loc, WNOHANG);
+  } while (ret == -1 && errno == EINTR);
+  if (ret == 0) {
+    return false;
+  }
+  // ECHILD means somebody else reaped it, report it as a clean exit.
+  *event = ToExitEvent(pid, ret == pid ? stat_loc : 0);
+  return true;
+}
+
+void Reaper::Sweep(std::unordered_map<Sink *, ExitBatch> *batches) {
+  // Peek whether any child at all is waitable before calling waitpid(2) for
+  // each watched pid.
+  siginfo_t info = {};
+  if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0) {
+    return;
+  }
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto current = it++;
+    ExitEvent event;
+    if (current->second.pidfd == -1 && !current->second.external &&
+        TryReap(current->first, &event)) {
+      Report(current->second, event, batches);
+      Remove(current);
+    }
+  }
+}
+
+void Reaper::Run() {
+  struct epoll_event events[kMaxEvents];
+  while (true) {
+    int timeout;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      timeout = unwatchable_ > 0 ? kSweepIntervalMs : -1;
+    }
+    int n = epoll_wait(epfd_, events, kMaxEvents, timeout);
+    if (n == -1 && errno != EINTR) {
+      Napi::Error::Fatal("reaper", "epoll_wait(2) failed");
+    }
+
+    std::unordered_map<Sink *, ExitBatch> batches;
+    std::vector<std::pair<FdHandler, int>> readable;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (int i = 0; i < n; i++) {
+        if (events[i].data.u64 & kFdTag) {
+          int fd = static_cast<int>(events[i].data.u64 & ~kFdTag);
+          auto it = fds_.find(fd);
+          if (it != fds_.end()) {
+            readable.emplace_back(it->second, fd);
+          }
+          continue;
+        }
+        pid_t pid = static_cast<pid_t>(events[i].data.u64);
+        if (pid == 0) {
+          uint64_t value;
+          if (read(wakefd_, &value, sizeof(value)) == -1) {}
+          continue;
+        }
+        auto it = entries_.find(pid);
+        ExitEvent event;
+        if (it == entries_.end() || !TryReap(pid, &event)) {
+          continue;
+        }
+        Report(it->second, event, &batches);
+        Remove(it);
+      }
+      if (unwatchable_ > 0) {
+        Sweep(&batches);
+      }
+      for (auto &it : batches) {
+        it.first->Post(new ExitBatch(std::move(it.second)));
+      }
+    }
+    // Handlers call back into the reaper, so they run without the lock.
+    for (auto &it : readable) {
+      it.first(it.second);
+    }
+  }
+}
+
+}  // namespace
+
+void Watch(Napi::Env env, Napi::Function cb, pid_t pid) {
+  Sink *sink = GetSink(env);
+  sink->Add(env, pid, cb);
+  Reaper::Get()->Watch(pid, sink);
+}
+
+void WatchExternal(Napi::Env env, Napi::Function cb, pid_t pid) {
+  Sink *sink = GetSink(env);
+  sink->Add(env, pid, cb);
+  Reaper::Get()->WatchExternal(pid, sink);
+}
+
+bool Detach(Napi::Env env, pid_t pid) {
+  Sink *sink = GetSink(env);
+  if (!sink->Remove(env, pid)) {
+    return false;
+  }
+  if (!Reaper::Get()->Detach(pid)) {
+    // Already reaped, the exit is on its way to this environment.
+    sink->Forward(pid);
+  }
+  return true;
+}
+
+void Adopt(Napi::Env env, Napi::Function cb, pid_t pid) {
+  Sink *sink = GetSink(env);
+  sink->Add(env, pid, cb);
+  Reaper::Get()->Adopt(pid, sink);
+}
+
+void Expect(pid_t pid, uint32_t serial) {
+  Reaper::Get()->Expect(pid, serial);
+}
+
+void Deliver(pid_t pid, int status, uint32_t serial) {
+  Reaper::Get()->Deliver(pid, status, serial);
+}
+
+void Orphan() {
+  Reaper::Get()->Orphan();
+}
+
+void WatchFd(int fd, FdHandler handler) {
+  Reaper::Get()->WatchFd(fd, handler);
+}
+
+void UnwatchFd(int fd) {
+  Reaper::Get()->UnwatchFd(fd);
+}
+
+}  // namespace reaper
+
+#endif  // defined(__linux__)
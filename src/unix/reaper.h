@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * reaper.h:
+ *   Shared child exit watcher used on Linux.
+ */
+
+#ifndef NODE_PTY_REAPER_H_
+#define NODE_PTY_REAPER_H_
+
+#define NODE_ADDON_API_DISABLE_DEPRECATED
+#include <napi.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace reaper {
+
+/**
+ * Calls `cb(exitCode, signal)` on the JS thread of `env` once `pid` exits.
+ *
+ * Every watched child in the process shares one reaper thread which waits on
+ * pidfds through epoll, so the thread count does not grow with the number of
+ * ptys. Exits observed in the same wakeup are delivered to JS as one batch.
+ */
+void Watch(Napi::Env env, Napi::Function cb, pid_t pid);
+
+/**
+ * Like `Watch`, for a process that is not a child of this process, such as a
+ * pty spawned by the zygote. It must have been passed to `Expect` and its
+ * exit must be reported through `Deliver`.
+ */
+void WatchExternal(Napi::Env env, Napi::Function cb, pid_t pid);
+
+/**
+ * Announces a process spawned by the zygote with the response numbered
+ * `serial`. Its exit is held until `WatchExternal`, and whatever is left for
+ * an earlier process with the same pid is dropped.
+ */
+void Expect(pid_t pid, uint32_t serial);
+
+/**
+ * Stops reporting the exit of a watched `pid` to `env`, so that another
+ * environment can take it over with `Adopt`. An exit in between is held until
+ * then. Returns false if the exit was already reported.
+ *
+ * A pid that is never adopted, such as when the handle is dropped or the
+ * worker it was posted to dies, is kept until the process exits, unless a new
+ * process with the same pid is watched.
+ */
+bool Detach(Napi::Env env, pid_t pid);
+
+/**
+ * Calls `cb(exitCode, signal)` on the JS thread of `env` once `pid`, which was
+ * passed to `Detach` before, exits.
+ */
+void Adopt(Napi::Env env, Napi::Function cb, pid_t pid);
+
+/**
+ * Reports the wait(2) `status` of an external process, after the zygote sent
+ * `serial` responses. May be called from any thread, also before `Expect`
+ * was called for `pid`. Exits that are never claimed are dropped by `Expect`
+ * of the same pid or by `Orphan`.
+ */
+void Deliver(pid_t pid, int status, uint32_t serial);
+
+/**
+ * Falls back to watching every external process through its pidfd once the
+ * process that would have reported its exit is gone. Their exit status is
+ * unknown and reported as 0, also for those that exited but were not passed
+ * to `WatchExternal` yet.
+ */
+void Orphan();
+
+typedef void (*FdHandler)(int fd);
+
+/**
+ * Calls `handler(fd)` on the reaper thread whenever `fd` is readable, until
+ * `UnwatchFd` is called.
+ */
+void WatchFd(int fd, FdHandler handler);
+void UnwatchFd(int fd);
+
+}  // namespace reaper
+
+#endif  // NODE_PTY_REAPER_H_
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * recorder.cc:
+ *   Records the session of a pty to a file.
+ */
+
+#include "recorder.h"
+#include "channel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace channel {
+
+// Buffered events are written once there are this many bytes of them.
+static const size_t kFlushSize = 65536;
+
+// Or this long after the first of them.
+static const uint64_t kFlushInterval = 1000;
+
+static void AppendLittleEndian(std::string *out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+// Appends `data` as the contents of a JSON string.
+static void AppendJsonString(std::string *out, const char *data, size_t length) {
+  static const char kHex[] = "0123456789abcdef";
+  const char *run = data;
+  const char *end = data + length;
+  for (const char *p = data; p < end; p++) {
+    unsigned char byte = static_cast<unsigned char>(*p);
+    if (byte >= 0x20 && byte != '"' && byte != '\\') {
+      continue;
+    }
+    out->append(run, p - run);
+    run = p + 1;
+    switch (byte) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        out->append("\\u00");
+        out->push_back(kHex[byte >> 4]);
+        out->push_back(kHex[byte & 0xf]);
+    }
+  }
+  out->append(run, end - run);
+}
+
+Recorder *Recorder::Open(uv_loop_t *loop, const std::string &path, Format format, int cols, int rows) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    return nullptr;
+  }
+  FdWriter *writer = FdWriter::Open(loop, fd);
+  if (!writer) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    return nullptr;
+  }
+  Recorder *recorder = new Recorder(loop, writer, format);
+  if (format == kAsciicast) {
+    char header[128];
+    snprintf(header, sizeof(header), "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld}\n",
+             cols, rows, static_cast<long long>(time(NULL)));
+    recorder->buffer_.append(header);
+  } else {
+    recorder->buffer_.append("NPTYREC1");
+    recorder->Resize(cols, rows);
+  }
+  recorder->Schedule();
+  return recorder;
+}
+
+Recorder::Recorder(uv_loop_t *loop, FdWriter *writer, Format format)
+    : writer_(writer), format_(format), start_(uv_hrtime()) {
+  uv_timer_init(loop, &timer_);
+  // A recording alone must not keep the loop alive.
+  uv_unref(reinterpret_cast<uv_handle_t *>(&timer_));
+  timer_.data = this;
+}
+
+void Recorder::AppendHeader(char type, size_t length) {
+  uint64_t elapsed = (uv_hrtime() - start_) / 1000;
+  if (format_ == kAsciicast) {
+    char header[64];
+    snprintf(header, sizeof(header), "[%" PRIu64 ".%06" PRIu64 ", \"%c\", \"",
+             elapsed / 1000000, elapsed % 1000000, type);
+    buffer_.append(header);
+  } else {
+    buffer_.push_back(type);
+    AppendLittleEndian(&buffer_, elapsed, 8);
+    AppendLittleEndian(&buffer_, length, 4);
+  }
+}
+
+void Recorder::Record(char type, const char *data, size_t length) {
+  if (failed_ || length == 0) {
+    return;
+  }
+  std::string joined;
+  if (format_ == kAsciicast) {
+    std::string &tail = type == 'o' ? output_tail_ : input_tail_;
+    if (!tail.empty()) {
+      joined.swap(tail);
+      joined.append(data, length);
+      data = joined.data();
+      length = joined.size();
+    }
+    // Escaped one event at a time, a sequence must not be split in two.
+    size_t complete = CompleteUtf8Length(data, length);
+    tail.assign(data + complete, length - complete);
+    length = complete;
+    if (length == 0) {
+      return;
+    }
+  }
+  AppendHeader(type, length);
+  if (format_ == kAsciicast) {
+    AppendJsonString(&buffer_, data, length);
+    buffer_.append("\"]\n");
+  } else {
+    buffer_.append(data, length);
+  }
+  Schedule();
+}
+
+void Recorder::Resize(int cols, int rows) {
+  if (failed_) {
+    return;
+  }
+  if (format_ == kAsciicast) {
+    AppendHeader('r', 0);
+    buffer_.append(std::to_string(cols) + "x" + std::to_string(rows) + "\"]\n");
+  } else {
+    AppendHeader('r', 4);
+    AppendLittleEndian(&buffer_, cols, 2);
+    AppendLittleEndian(&buffer_, rows, 2);
+  }
+  Schedule();
+}
+
+void Recorder::OnTimer(uv_timer_t *handle) {
+  Recorder *self = static_cast<Recorder *>(handle->data);
+  self->timer_active_ = false;
+  self->Write();
+}
+
+void Recorder::Schedule() {
+  if (buffer_.size() >= kFlushSize) {
+    Write();
+  } else if (!timer_active_) {
+    timer_active_ = true;
+    uv_timer_start(&timer_, OnTimer, kFlushInterval, 0);
+  }
+}
+
+void Recorder::Write() {
+  if (timer_active_) {
+    timer_active_ = false;
+    uv_timer_stop(&timer_);
+  }
+  if (!failed_ && !buffer_.empty() && !writer_->Write(buffer_)) {
+    failed_ = true;
+  }
+  buffer_.clear();
+}
+
+void Recorder::Close() {
+  Write();
+  writer_->Close();
+  writer_ = nullptr;
+  uv_close(reinterpret_cast<uv_handle_t *>(&timer_), OnClosed);
+}
+
+void Recorder::OnClosed(uv_handle_t *handle) {
+  delete static_cast<Recorder *>(handle->data);
+}
+
+}  // namespace channel
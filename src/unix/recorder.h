@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * recorder.h:
+ *   Records the session of a pty to a file.
+ */
+
+#ifndef NODE_PTY_RECORDER_H_
+#define NODE_PTY_RECORDER_H_
+
+#include <uv.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "fd_writer.h"
+
+namespace channel {
+
+/**
+ * Writes the output, input and resizes of a pty to a file as they happen,
+ * with the time since the recording started.
+ *
+ * kAsciicast writes asciicast v2, a JSON header line followed by an
+ * `[time, type, data]` line per event, `data` being the bytes as a JSON
+ * string, which assumes UTF-8 output. An incomplete UTF-8 sequence at the
+ * end of the output or input is held back until the rest of it arrives, it
+ * is dropped if the recording ends first. kRaw writes "NPTYREC1" followed by a
+ * record per event: its type as one byte ('o', 'i' or 'r'), the microseconds
+ * since the start as a 64-bit and the length of the data as a 32-bit little
+ * endian integer, then the data, the bytes as they are or, for resizes, the
+ * columns and rows as 16-bit little endian integers.
+ *
+ * Events are buffered and handed to an FdWriter in batches, once 64 KiB are
+ * buffered or a second after the first of them, so that the file is written
+ * off the event loop. Recording stops at the first failed write. Called on
+ * the thread of `loop`.
+ */
+class Recorder {
+ public:
+  enum Format { kAsciicast, kRaw };
+
+  // Returns nullptr with errno set if the file could not be created.
+  static Recorder *Open(uv_loop_t *loop, const std::string &path, Format format, int cols, int rows);
+
+  void Output(const char *data, size_t length) { Record('o', data, length); }
+  void Input(const char *data, size_t length) { Record('i', data, length); }
+  void Resize(int cols, int rows);
+  // Writes what is buffered and closes the file. The object deletes itself.
+  void Close();
+
+ private:
+  Recorder(uv_loop_t *loop, FdWriter *writer, Format format);
+  ~Recorder() {}
+
+  static void OnTimer(uv_timer_t *handle);
+  static void OnClosed(uv_handle_t *handle);
+
+  void Record(char type, const char *data, size_t length);
+  void AppendHeader(char type, size_t length);
+  // Called after every event, writes the buffer once it is full or due.
+  void Schedule();
+  void Write();
+
+  // Deletes itself once closed.
+  FdWriter *writer_;
+  Format format_;
+  uint64_t start_;
+  std::string buffer_;
+  // Incomplete UTF-8 sequences held back, see kAsciicast.
+  std::string output_tail_;
+  std::string input_tail_;
+  uv_timer_t timer_;
+  bool timer_active_ = false;
+  bool failed_ = false;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_RECORDER_H_
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * scrollback.cc:
+ *   Bounded native buffer of the latest output of a pty.
+ */
+
+#include "scrollback.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace channel {
+
+void Scrollback::Append(const char *data, size_t length) {
+  if (capacity_ == 0 || length == 0) {
+    return;
+  }
+  if (end_ + length <= capacity_) {
+    // Nothing was dropped yet, the buffer is filled from the start.
+    if (buffer_.capacity() < end_ + length) {
+      buffer_.reserve(std::min(capacity_, std::max(buffer_.capacity() * 2, static_cast<size_t>(end_ + length))));
+    }
+    buffer_.insert(buffer_.end(), data, data + length);
+    end_ += length;
+    return;
+  }
+  // Byte `offset` lives at `offset % capacity_` from now on, which also holds
+  // for the bytes appended so far.
+  buffer_.resize(capacity_);
+  if (length > capacity_) {
+    data += length - capacity_;
+    end_ += length - capacity_;
+    length = capacity_;
+  }
+  while (length > 0) {
+    size_t position = end_ % capacity_;
+    size_t n = std::min(length, capacity_ - position);
+    memcpy(buffer_.data() + position, data, n);
+    end_ += n;
+    data += n;
+    length -= n;
+  }
+}
+
+void Scrollback::CopyFrom(uint64_t offset, char *out) const {
+  size_t length = end_ - offset;
+  if (length == 0) {
+    return;
+  }
+  size_t position = offset % capacity_;
+  size_t first = std::min(length, capacity_ - position);
+  memcpy(out, buffer_.data() + position, first);
+  memcpy(out + first, buffer_.data(), length - first);
+}
+
+}  // namespace channel
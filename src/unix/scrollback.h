@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * scrollback.h:
+ *   Bounded native buffer of the latest output of a pty.
+ */
+
+#ifndef NODE_PTY_SCROLLBACK_H_
+#define NODE_PTY_SCROLLBACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace channel {
+
+/**
+ * Keeps the last `capacity` bytes of a stream in a ring buffer. Bytes are
+ * addressed by their offset in the stream, the number of bytes appended
+ * before them, so a reader can ask for everything after the last byte it saw.
+ *
+ * The buffer grows with the output up to `capacity` and does not shrink.
+ */
+class Scrollback {
+ public:
+  explicit Scrollback(size_t capacity) : capacity_(capacity) {}
+
+  void Append(const char *data, size_t length);
+  // The offset the buffered output starts at, earlier output was dropped.
+  uint64_t start() const { return end_ - std::min<uint64_t>(end_, capacity_); }
+  // The offset after the last byte appended.
+  uint64_t end() const { return end_; }
+  // Copies the output from `offset`, which must be between start() and
+  // end(), to `out`, which has room for `end() - offset` bytes.
+  void CopyFrom(uint64_t offset, char *out) const;
+
+ private:
+  size_t capacity_;
+  std::vector<char> buffer_;
+  uint64_t end_ = 0;
+};
+
+}  // namespace channel
+
+#endif  // NODE_PTY_SCROLLBACK_H_
@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * spawn-zygote.cc:
+ *   Helper process that forks ptys on behalf of node-pty. It is started once
+ *   and stays small, so unlike forking from a Node process with a large heap
+ *   its forkpty(3) does not have to copy many page tables. See
+ *   zygote_protocol.h for the messages it exchanges with node-pty.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include <vector>
+
+#include "zygote_protocol.h"
+
+/* NSIG - macro for highest signal + 1, should be defined */
+#ifndef NSIG
+#define NSIG 32
+#endif
+
+extern char **environ;
+
+// The number of responses sent so far, see zygote_protocol.h.
+static uint32_t serial = 0;
+
+static void close_other_fds(void) {
+  DIR *dir = opendir("/proc/self/fd");
+  if (dir == NULL) {
+    return;
+  }
+  std::vector<int> fds;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    int fd = atoi(entry->d_name);
+    if (fd > zygote::kEventFd && fd != dirfd(dir)) {
+      fds.push_back(fd);
+    }
+  }
+  closedir(dir);
+  for (int fd : fds) {
+    close(fd);
+  }
+}
+
+static void send_response(pid_t pid, int error, int master) {
+  zygote::Response response;
+  response.pid = pid;
+  response.error = error;
+  response.serial = ++serial;
+
+  struct iovec iov;
+  iov.iov_base = &response;
+  iov.iov_len = sizeof(response);
+
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (master != -1) {
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &master, sizeof(int));
+  }
+
+  while (sendmsg(zygote::kRequestFd, &msg, MSG_NOSIGNAL) == -1) {
+    if (errno != EINTR) {
+      // node-pty is gone.
+      _exit(0);
+    }
+  }
+}
+
+static void spawn(zygote::RequestHeader *header, std::vector<char> *payload, const sigset_t *oldmask) {
+  // Split the payload into its strings.
+  std::vector<char *> strings;
+  char *p = payload->data();
+  char *end = p + payload->size();
+  while (p < end) {
+    strings.push_back(p);
+    p += strlen(p) + 1;
+  }
+  if (payload->empty() || payload->back() != '\0' ||
+      strings.size() != 2 + header->argc + header->envc) {
+    send_response(-1, EINVAL, -1);
+    return;
+  }
+
+  char *file = strings[0];
+  char *cwd = strings[1];
+  std::vector<char *> argv(strings.begin() + 2, strings.begin() + 2 + header->argc);
+  argv.insert(argv.begin(), file);
+  argv.push_back(NULL);
+  std::vector<char *> env(strings.begin() + 2 + header->argc, strings.end());
+  env.push_back(NULL);
+
+  int master;
+  pid_t pid = forkpty(&master, nullptr, &header->termp, &header->winp);
+
+  switch (pid) {
+    case -1:
+      send_response(-1, errno, -1);
+      return;
+    case 0: {
+      // remove all signal handler from child
+      struct sigaction sig_action;
+      sig_action.sa_handler = SIG_DFL;
+      sig_action.sa_flags = 0;
+      sigemptyset(&sig_action.sa_mask);
+      for (int i = 0 ; i < NSIG ; i++) {    // NSIG is a macro for all signals + 1
+        sigaction(i, &sig_action, NULL);
+      }
+      sigprocmask(SIG_SETMASK, oldmask, NULL);
+
+      if (strlen(cwd)) {
+        if (chdir(cwd) == -1) {
+          perror("chdir(2) failed.");
+          _exit(1);
+        }
+      }
+
+      if (header->uid != -1 && header->gid != -1) {
+        if (setgid(header->gid) == -1) {
+          perror("setgid(2) failed.");
+          _exit(1);
+        }
+        if (setuid(header->uid) == -1) {
+          perror("setuid(2) failed.");
+          _exit(1);
+        }
+      }
+
+      environ = env.data();
+      execvp(argv[0], argv.data());
+      perror("execvp(3) failed.");
+      _exit(1);
+    }
+    default:
+      send_response(pid, 0, master);
+      close(master);
+  }
+}
+
+static void reap_children(void) {
+  int status;
+  pid_t pid;
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+    zygote::ExitRecord record;
+    record.pid = pid;
+    record.status = status;
+    record.serial = serial;
+    if (!zygote::SendAll(zygote::kEventFd, &record, sizeof(record))) {
+      // node-pty is gone.
+      _exit(0);
+    }
+  }
+}
+
+int main() {
+  // Leave the session of node-pty so signals sent to its process group from
+  // its terminal, like ^C, do not take the zygote down with it.
+  setsid();
+  close_other_fds();
+  fcntl(zygote::kRequestFd, F_SETFD, FD_CLOEXEC);
+  fcntl(zygote::kEventFd, F_SETFD, FD_CLOEXEC);
+
+  sigset_t mask, oldmask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, &oldmask);
+  int sigfd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+  if (sigfd == -1) {
+    perror("signalfd(2) failed.");
+    return 1;
+  }
+
+  struct pollfd fds[2];
+  fds[0].fd = zygote::kRequestFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = sigfd;
+  fds[1].events = POLLIN;
+
+  while (true) {
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll(2) failed.");
+      return 1;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      struct signalfd_siginfo info;
+      while (read(sigfd, &info, sizeof(info)) > 0) {}
+      reap_children();
+    }
+
+    if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+      zygote::RequestHeader header;
+      if (!zygote::RecvAll(zygote::kRequestFd, &header, sizeof(header))) {
+        // node-pty closed its end, the ptys spawned so far keep running.
+        return 0;
+      }
+      std::vector<char> payload(header.size);
+      if (!zygote::RecvAll(zygote::kRequestFd, payload.data(), payload.size())) {
+        return 0;
+      }
+      spawn(&header, &payload, &oldmask);
+    }
+  }
+}
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * spawn_request.h:
+ *   Description of a pty child that is independent of the JS thread.
+ */
+
+#ifndef NODE_PTY_SPAWN_REQUEST_H_
+#define NODE_PTY_SPAWN_REQUEST_H_
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace spawn {
+
+/**
+ * Everything needed to spawn a pty child, parsed from the arguments of
+ * `pty.fork` on the JS thread so that the spawn itself can run on any thread.
+ */
+struct Request {
+  std::string file;
+  // Arguments following argv[0], which is `file`.
+  std::vector<std::string> args;
+  // `key=value` pairs, shared as many requests may be built from one parsed
+  // environment, see EnvBlock.
+  std::shared_ptr<const std::vector<std::string>> env;
+  // `key=value` pairs replacing the pair of the same key in `env`, or added.
+  std::vector<std::string> env_overrides;
+  std::string cwd;
+  int uid = -1;
+  int gid = -1;
+  struct winsize winp;
+  struct termios termp;
+  // spawn-helper on macOS, spawn-zygote for the "zygote" method.
+  std::string helper_path;
+  // "default", "forkpty" or "zygote".
+  std::string method;
+};
+
+/**
+ * Returns the NULL terminated environment of `request` with its overrides
+ * applied. The pointers are into the strings of `request`, nothing is copied.
+ */
+inline std::vector<char *> EnvPointers(const Request& request) {
+  const std::vector<std::string>& overrides = request.env_overrides;
+  std::vector<bool> applied(overrides.size());
+  std::vector<char *> env;
+  env.reserve(request.env->size() + overrides.size() + 1);
+  for (const std::string& pair : *request.env) {
+    const std::string *value = &pair;
+    for (size_t i = 0; i < overrides.size(); i++) {
+      // The key including the '='
+      size_t key_length = overrides[i].find('=') + 1;
+      if (!applied[i] && key_length != 0 && pair.compare(0, key_length, overrides[i], 0, key_length) == 0) {
+        value = &overrides[i];
+        applied[i] = true;
+        break;
+      }
+    }
+    env.push_back(const_cast<char *>(value->c_str()));
+  }
+  for (size_t i = 0; i < overrides.size(); i++) {
+    if (!applied[i]) {
+      env.push_back(const_cast<char *>(overrides[i].c_str()));
+    }
+  }
+  env.push_back(NULL);
+  return env;
+}
+
+struct Result {
+  int master = -1;
+  pid_t pid = -1;
+  // The child belongs to the zygote, which reports its exit.
+  bool external = false;
+  // Empty on success.
+  std::string error;
+};
+
+}  // namespace spawn
+
+#endif  // NODE_PTY_SPAWN_REQUEST_H_
@@ -0,0 +1,288 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * zygote.cc:
+ *   Starts spawn-zygote and sends it spawn requests.
+ *
+ *   Requests are sent and answered synchronously on the calling thread. Exits
+ *   of the spawned children arrive on a separate socket that is read by the
+ *   reaper thread and handed to reaper::Deliver. It is only ever read with
+ *   `mutex` held, also by a spawn waiting for its response.
+ */
+
+#if defined(__linux__)
+
+#include "zygote.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <mutex>
+
+#include "reaper.h"
+#include "zygote_protocol.h"
+
+extern char **environ;
+
+namespace zygote {
+
+namespace {
+
+std::mutex mutex;
+pid_t zygote_pid = -1;
+int request_fd = -1;
+int event_fd = -1;
+
+std::string ErrnoMessage(const char *what, int error) {
+  return std::string(what) + " failed: " + strerror(error);
+}
+
+// Hands all exits received so far to the reaper. Returns false once the
+// zygote closed the socket. Called with `mutex` held.
+bool ReadEvents(int fd) {
+  ExitRecord record;
+  while (true) {
+    ssize_t n = recv(fd, &record, sizeof(record), MSG_DONTWAIT);
+    if (n == sizeof(record)) {
+      reaper::Deliver(record.pid, record.status, record.serial);
+      continue;
+    }
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  }
+}
+
+// Drops the current zygote, called with `mutex` held.
+void Reset() {
+  if (zygote_pid == -1) {
+    return;
+  }
+  ReadEvents(event_fd);
+  reaper::UnwatchFd(event_fd);
+  close(request_fd);
+  close(event_fd);
+  // Closing the request socket makes it exit if it is still running.
+  int status;
+  while (waitpid(zygote_pid, &status, 0) == -1 && errno == EINTR) {}
+  zygote_pid = -1;
+  request_fd = -1;
+  event_fd = -1;
+  // Children that are still running are no longer reported by anyone.
+  reaper::Orphan();
+}
+
+// Runs on the reaper thread.
+void OnEvents(int fd) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (fd != event_fd) {
+    // Closed by Reset since it was found readable, the number may already
+    // belong to another socket.
+    return;
+  }
+  if (!ReadEvents(fd)) {
+    // The zygote is gone, the next spawn starts a new one.
+    Reset();
+  }
+}
+
+// Waits until the response to a request can be read. Exits are read in the
+// meantime: the reaper thread can not while `mutex` is held, and the zygote
+// would block on a full event socket before it answers.
+void AwaitResponse() {
+  struct pollfd fds[2];
+  fds[0].fd = request_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = event_fd;
+  fds[1].events = POLLIN;
+  while (true) {
+    fds[0].revents = fds[1].revents = 0;
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (fds[1].revents) {
+      if (!ReadEvents(event_fd)) {
+        // Closed, the response will not come either.
+        fds[1].fd = -1;
+      }
+    }
+    if (fds[0].revents) {
+      return;
+    }
+  }
+}
+
+std::string Launch(const std::string& path) {
+  int request[2], event[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, request) == -1) {
+    return ErrnoMessage("socketpair(2)", errno);
+  }
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, event) == -1) {
+    int error = errno;
+    close(request[0]);
+    close(request[1]);
+    return ErrnoMessage("socketpair(2)", error);
+  }
+
+  // The child ends are moved above the fds they are dup2'd to: dup2 of an fd
+  // onto itself keeps FD_CLOEXEC, and the first dup2 could replace the
+  // source of the second.
+  for (int *fd : { &request[1], &event[1] }) {
+    int moved = fcntl(*fd, F_DUPFD_CLOEXEC, kEventFd + 1);
+    if (moved == -1) {
+      int error = errno;
+      close(request[0]);
+      close(request[1]);
+      close(event[0]);
+      close(event[1]);
+      return ErrnoMessage("fcntl(2)", error);
+    }
+    close(*fd);
+    *fd = moved;
+  }
+
+  posix_spawn_file_actions_t acts;
+  posix_spawn_file_actions_init(&acts);
+  posix_spawn_file_actions_adddup2(&acts, request[1], kRequestFd);
+  posix_spawn_file_actions_adddup2(&acts, event[1], kEventFd);
+
+  posix_spawnattr_t attrs;
+  posix_spawnattr_init(&attrs);
+  posix_spawnattr_setflags(&attrs, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+  sigset_t signal_set;
+  sigfillset(&signal_set);
+  posix_spawnattr_setsigdefault(&attrs, &signal_set);
+  sigemptyset(&signal_set);
+  posix_spawnattr_setsigmask(&attrs, &signal_set);
+
+  // glibc implements posix_spawn(3) with CLONE_VFORK, so this does not copy
+  // the address space of the Node process either.
+  char *argv[] = { const_cast<char *>(path.c_str()), NULL };
+  pid_t pid;
+  int error = posix_spawn(&pid, path.c_str(), &acts, &attrs, argv, environ);
+  posix_spawn_file_actions_destroy(&acts);
+  posix_spawnattr_destroy(&attrs);
+  close(request[1]);
+  close(event[1]);
+  if (error != 0) {
+    close(request[0]);
+    close(event[0]);
+    return ErrnoMessage("posix_spawn(3) of the spawn zygote", error);
+  }
+
+  zygote_pid = pid;
+  request_fd = request[0];
+  event_fd = event[0];
+  fcntl(event_fd, F_SETFL, fcntl(event_fd, F_GETFL) | O_NONBLOCK);
+  reaper::WatchFd(event_fd, OnEvents);
+  return std::string();
+}
+
+}  // namespace
+
+std::string Start(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (zygote_pid != -1) {
+    return std::string();
+  }
+  return Launch(path);
+}
+
+std::string Spawn(const spawn::Request& request, int *master, pid_t *pid) {
+  std::vector<char> payload;
+  auto append = [&payload](const std::string& value) {
+    payload.insert(payload.end(), value.c_str(), value.c_str() + value.size() + 1);
+  };
+  append(request.file);
+  append(request.cwd);
+  for (const std::string& arg : request.args) {
+    append(arg);
+  }
+  std::vector<char *> env = spawn::EnvPointers(request);
+  for (size_t i = 0; env[i] != NULL; i++) {
+    payload.insert(payload.end(), env[i], env[i] + strlen(env[i]) + 1);
+  }
+
+  RequestHeader header = {};
+  header.size = payload.size();
+  header.argc = request.args.size();
+  header.envc = env.size() - 1;
+  header.uid = request.uid;
+  header.gid = request.gid;
+  header.winp = request.winp;
+  header.termp = request.termp;
+
+  // Held until the response arrived, only one request is ever in flight. This
+  // costs no concurrency: the zygote handles requests one at a time anyway,
+  // and answers right after forking, without waiting for the exec.
+  std::lock_guard<std::mutex> lock(mutex);
+  if (zygote_pid == -1) {
+    std::string error = Launch(request.helper_path);
+    if (!error.empty()) {
+      return error;
+    }
+  }
+
+  if (!SendAll(request_fd, &header, sizeof(header)) ||
+      !SendAll(request_fd, payload.data(), payload.size())) {
+    int error = errno;
+    Reset();
+    return ErrnoMessage("Sending to the spawn zygote", error);
+  }
+
+  Response response;
+  struct iovec iov;
+  iov.iov_base = &response;
+  iov.iov_len = sizeof(response);
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  AwaitResponse();
+  ssize_t n;
+  do {
+    n = recvmsg(request_fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (n == -1 && errno == EINTR);
+  if (n > 0 && n < static_cast<ssize_t>(sizeof(response))) {
+    if (!RecvAll(request_fd, reinterpret_cast<char *>(&response) + n, sizeof(response) - n)) {
+      n = 0;
+    }
+  }
+  if (n <= 0) {
+    Reset();
+    return "The spawn zygote exited unexpectedly.";
+  }
+
+  *master = -1;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+    memcpy(master, CMSG_DATA(cmsg), sizeof(int));
+  }
+  if (response.pid == -1) {
+    return ErrnoMessage("forkpty(3) in the spawn zygote", response.error);
+  }
+  if (*master == -1) {
+    return "The spawn zygote did not send the pty.";
+  }
+  reaper::Expect(response.pid, response.serial);
+  *pid = response.pid;
+  return std::string();
+}
+
+}  // namespace zygote
+
+#endif  // defined(__linux__)
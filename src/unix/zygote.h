@@ -0,0 +1,36 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * zygote.h:
+ *   Client of the spawn-zygote helper process, Linux only.
+ */
+
+#ifndef NODE_PTY_ZYGOTE_H_
+#define NODE_PTY_ZYGOTE_H_
+
+#include <sys/types.h>
+#include <string>
+
+#include "spawn_request.h"
+
+namespace zygote {
+
+/**
+ * Starts the zygote at `path` unless it is already running. One zygote is
+ * shared by all environments of the process. Returns an empty string or an
+ * error message.
+ */
+std::string Start(const std::string& path);
+
+/**
+ * Spawns `request` through the zygote at `request.helper_path`, which is
+ * started first if needed. On success the pty master is stored in `master` and
+ * the child in `pid`, whose exit is reported through reaper::Deliver. Returns
+ * an empty string or an error message. May be called from any thread, calls
+ * are serialized.
+ */
+std::string Spawn(const spawn::Request& request, int *master, pid_t *pid);
+
+}  // namespace zygote
+
+#endif  // NODE_PTY_ZYGOTE_H_
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ *
+ * zygote_protocol.h:
+ *   Messages exchanged between node-pty and spawn-zygote.
+ *
+ *   The zygote finds a SOCK_STREAM socket at kRequestFd and a SOCK_SEQPACKET
+ *   socket at kEventFd. Each request is a RequestHeader followed by `size`
+ *   bytes of NUL terminated strings: file, cwd, `argc` arguments and `envc`
+ *   environment entries. It is answered by a Response that carries the pty
+ *   master as SCM_RIGHTS if the spawn succeeded. Exits of spawned children are
+ *   sent as one ExitRecord per message on the event socket.
+ *
+ *   Both sockets are read independently, so an exit of an earlier process
+ *   can be read after the response for a new one with the same pid. Serial
+ *   numbers tell them apart: an exit belongs to the child of a response if
+ *   its `serial` is at least that of the response.
+ */
+
+#ifndef NODE_PTY_ZYGOTE_PROTOCOL_H_
+#define NODE_PTY_ZYGOTE_PROTOCOL_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+namespace zygote {
+
+const int kRequestFd = 3;
+const int kEventFd = 4;
+
+struct RequestHeader {
+  uint32_t size;
+  uint32_t argc;
+  uint32_t envc;
+  int32_t uid;
+  int32_t gid;
+  struct winsize winp;
+  struct termios termp;
+};
+
+struct Response {
+  // The child pid, or -1 if the spawn failed with `error`.
+  int32_t pid;
+  int32_t error;
+  // The number of responses sent so far, this one included.
+  uint32_t serial;
+};
+
+struct ExitRecord {
+  int32_t pid;
+  // The wait(2) status.
+  int32_t status;
+  // The number of responses sent before this record.
+  uint32_t serial;
+};
+
+inline bool SendAll(int fd, const void *data, size_t length) {
+  const char *p = static_cast<const char *>(data);
+  while (length > 0) {
+    ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += n;
+    length -= n;
+  }
+  return true;
+}
+
+// Returns false on errors and if the peer closed the socket before `length`
+// bytes arrived.
+inline bool RecvAll(int fd, void *data, size_t length) {
+  char *p = static_cast<char *>(data);
+  while (length > 0) {
+    ssize_t n = recv(fd, p, length, 0);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    length -= n;
+  }
+  return true;
+}
+
+}  // namespace zygote
+
+#endif  // NODE_PTY_ZYGOTE_PROTOCOL_H_
@@ -0,0 +1,311 @@
+/**
+ * Copyright (c) 2018, Microsoft Corporation (MIT License).
+ */
+
+import { Duplex } from 'stream';
+import { StringDecoder } from 'string_decoder';
+import { requireBinary } from './requireBinary';
+
+const pty = requireBinary<IUnixNative>('pty.node');
+
+const DEFAULT_FLUSH_SIZE = 65536;
+
+export interface IUnixChannelStreamOptions {
+  flushInterval?: number;
+  flushSize?: number;
+  /**
+   * The number of reusable `flushSize` byte buffers output is read into. Output read into them is
+   * emitted as Buffer views without copying and must be handed back with `release`.
+   */
+  poolSize?: number;
+  /**
+   * The number of bytes of output that may be emitted without being acknowledged with `ack`
+   * before the pty is no longer read, 0 (the default) disables this. Reading resumes once no more
+   * than `lowWatermark` bytes, half of `highWatermark` by default, are unacknowledged.
+   */
+  highWatermark?: number;
+  lowWatermark?: number;
+  /**
+   * Decode output as UTF-8 natively. Chunks are only cut at code point boundaries so each is
+   * decoded in one go and emitted as a string, a decoder set with `setEncoding` passes them through.
+   */
+  utf8?: boolean;
+  /**
+   * Run the channel on one of node-pty's shared native I/O threads, which keep reading and writing
+   * while the JS thread is busy. A pool cannot be used then.
+   */
+  thread?: boolean;
+  /**
+   * The number of bytes of the latest output to keep natively for `snapshot`, none by default.
+   */
+  scrollback?: number;
+}
+
+/**
+ * A stream over a pty master fd that is read and written by node-pty's native
+ * channel instead of libuv's tty handle. Output arrives coalesced, see
+ * `IUnixChannelStreamOptions`. The stream takes ownership of the fd.
+ */
+export class UnixChannel extends Duplex {
+  private _channel: IUnixChannel;
+  private _pool: Buffer[] = [];
+  // The callback of the last write while the native queue is above the high water mark
+  private _pendingWriteCallback: ((error?: Error | null) => void) | undefined;
+  // Byte offsets of the chunks pushed and not emitted yet, in order
+  private _offsets: number[] = [];
+  private _chunkOffset: number = 0;
+  // Bytes of output read so far
+  private _readBytes: number = 0;
+  // Set by setEncoding. Named like the decoder of net.Socket, which Terminal.setEncoding deletes
+  // to stop decoding.
+  private _decoder: StringDecoder | undefined;
+
+  constructor(fd: number, options: IUnixChannelStreamOptions) {
+    // The pty is gone once its output ended, end the writable side with it.
+    // Every chunk is emitted as it was pushed, with the byte offset the channel counted. Object
+    // mode makes sure chunks are never concatenated, and pooled and decoded ones never turned
+    // into Buffers.
+    super({ allowHalfOpen: false, readableObjectMode: true });
+
+    for (let i = 0; i < (options.poolSize || 0); i++) {
+      this._pool.push(Buffer.from(new ArrayBuffer(options.flushSize || DEFAULT_FLUSH_SIZE)));
+    }
+
+    const channelOptions: IUnixChannelOptions = {
+      flushInterval: options.flushInterval,
+      flushSize: options.flushSize,
+      highWatermark: options.highWatermark,
+      lowWatermark: options.lowWatermark,
+      utf8: options.utf8,
+      thread: options.thread,
+      scrollback: options.scrollback,
+      pool: this._pool.map(buffer => buffer.buffer as ArrayBuffer)
+    };
+    this._channel = new pty.Channel(fd, channelOptions, (data, length, offset) => {
+      let chunk = typeof data === 'number' ? this._pool[data].subarray(0, length) : data;
+      this._readBytes = offset + length;
+      if (this._decoder && typeof chunk !== 'string') {
+        // A character split between chunks is emitted with the later one, at the offset it starts at
+        offset -= this._carriedBytes();
+        chunk = this._decoder.write(chunk);
+        if (typeof data === 'number') {
+          this._channel.release(data);
+        }
+        if (chunk.length === 0) {
+          return;
+        }
+      }
+      this._push(chunk, offset);
+    }, errorCode => {
+      if (errorCode) {
+        const err: any = new Error(`read ${errorCode}`);
+        err.code = errorCode;
+        this.destroy(err);
+        return;
+      }
+      const restOffset = this._readBytes - this._carriedBytes();
+      const rest = this._decoder ? this._decoder.end() : '';
+      if (rest.length !== 0) {
+        this._push(rest, restOffset);
+      }
+      this.push(null);
+    }, () => {
+      const callback = this._pendingWriteCallback;
+      if (callback) {
+        this._pendingWriteCallback = undefined;
+        callback();
+      }
+    });
+  }
+
+  /**
+   * The number of bytes of an incomplete character the decoder holds back for the next chunk.
+   */
+  private _carriedBytes(): number {
+    // Not in the typings, but kept by every string_decoder since the first one
+    const decoder: any = this._decoder;
+    return decoder ? (decoder.lastTotal - decoder.lastNeed) || 0 : 0;
+  }
+
+  /**
+   * The byte offset in all output of the pty of the chunk emitted by the current `data` event.
+   */
+  public get chunkOffset(): number {
+    return this._chunkOffset;
+  }
+
+  public emit(event: string | symbol, ...args: any[]): boolean {
+    if (event === 'data') {
+      // Every push is emitted as one data event, in order
+      this._chunkOffset = this._offsets.shift()!;
+    }
+    return super.emit(event, ...args);
+  }
+
+  /**
+   * Decodes further output with `encoding`. Chunks decoded natively with `utf8` are passed through.
+   */
+  public setEncoding(encoding: string): this {
+    this._decoder = new StringDecoder(encoding);
+    return this;
+  }
+
+  private _push(chunk: string | Buffer, offset: number): void {
+    this._offsets.push(offset);
+    if (!this.push(chunk)) {
+      this._channel.pause();
+    }
+  }
+
+  /**
+   * The number of bytes written that did not reach the pty yet. Writes are queued natively and
+   * everything queued within one turn of the event loop is written with a single writev(2).
+   */
+  public get queuedBytes(): number {
+    return this._channel.queuedBytes();
+  }
+
+  /**
+   * Acknowledges that `length` bytes of output were consumed, all output emitted so far without a
+   * length. See `IUnixChannelStreamOptions.highWatermark`.
+   */
+  public ack(length?: number): void {
+    if (length === undefined) {
+      this._channel.ack();
+    } else {
+      this._channel.ack(length);
+    }
+  }
+
+  /**
+   * Returns the output kept with `scrollback` from byte `offset` of all output on, as a string
+   * with `utf8`. `offset` of the result is where it actually starts, later than requested when
+   * older output was dropped already.
+   */
+  public snapshot(offset?: number): { offset: number, data: Buffer | string } {
+    return offset === undefined ? this._channel.snapshot() : this._channel.snapshot(offset);
+  }
+
+  /**
+   * Scans all further output for `patterns` natively and emits `match` with the index of the
+   * pattern and the byte offset of its first byte in all output for every occurrence, after the
+   * output it ends in was handed to the stream. Replaces the patterns scanned for so far, none
+   * stops scanning.
+   */
+  public match(patterns: Array<string | Buffer>): void {
+    this._channel.match(patterns.map(pattern => typeof pattern === 'string' ? Buffer.from(pattern) : pattern), matches => {
+      for (let i = 0; i < matches.length; i += 2) {
+        this.emit('match', matches[i], matches[i + 1]);
+      }
+    });
+  }
+
+  /**
+   * Strips escape sequences and control characters but tabs and line feeds from all further output
+   * natively and passes the text to `target` after the output was handed to the stream, as a string
+   * with `utf8`. If `target` is an fd the text is written to a copy of it off the event loop
+   * instead, pipes and sockets are made non-blocking. Writing stops at the first error or once more
+   * than 4 MiB wait to be written. Without a target stripping stops.
+   */
+  public plain(target?: number | ((text: Buffer | string) => void)): void {
+    if (target === undefined) {
+      this._channel.plain();
+    } else {
+      this._channel.plain(target);
+    }
+  }
+
+  /**
+   * Records all further output, and input with `input`, natively to a new file at `path`, in
+   * batched writes. Replaces any recording so far.
+   */
+  public record(path: string, options: { format?: 'asciicast' | 'raw', input?: boolean, cols: number, rows: number }): void {
+    this._channel.record(path, options);
+  }
+
+  public recordResize(cols: number, rows: number): void {
+    this._channel.recordResize(cols, rows);
+  }
+
+  public stopRecording(): void {
+    this._channel.record();
+  }
+
+  /**
+   * Deflates all further output natively and passes the frame of every chunk to `target` with the
+   * byte offset and length of the chunk, after the output was handed to the stream. If `target` is
+   * an fd a gzip stream is written to a copy of it off the event loop instead, ended when
+   * compression stops. Pipes and sockets are made non-blocking. Writing stops at the first error
+   * or once more than 4 MiB wait to be written, which leaves the stream cut short without its
+   * trailer. Without a target compression stops.
+   */
+  public compress(target?: number | ((frame: Buffer, offset: number, length: number) => void), level?: number): void {
+    if (target === undefined) {
+      this._channel.compress();
+    } else if (level === undefined) {
+      this._channel.compress(target);
+    } else {
+      this._channel.compress(target, level);
+    }
+  }
+
+  /**
+   * Stops emitting output and copies between the pty and `targetFd` natively instead, in both
+   * directions, until either side is closed. `onEnd` is called then, with the code of the error
+   * that ended it if any. Nothing is read afterwards, the stream is not ended by it.
+   */
+  public forward(targetFd: number, onEnd: (errorCode?: string) => void): void {
+    this._channel.forward(targetFd, onEnd);
+  }
+
+  /**
+   * Hands a chunk emitted from the buffer pool back so that it can be reused.
+   * Other chunks are ignored.
+   */
+  public release(chunk: Buffer): void {
+    for (let i = 0; i < this._pool.length; i++) {
+      if (this._pool[i].buffer === chunk.buffer) {
+        // A transferred buffer is detached and must not be written to again.
+        if (chunk.buffer.byteLength !== 0) {
+          this._channel.release(i);
+        }
+        return;
+      }
+    }
+  }
+
+  // eslint-disable-next-line @typescript-eslint/naming-convention
+  public _read(size: number): void {
+    this._channel.resume();
+  }
+
+  // eslint-disable-next-line @typescript-eslint/naming-convention
+  public _write(chunk: Buffer, encoding: string, callback: (error?: Error | null) => void): void {
+    this._queued(this._channel.write(chunk), callback);
+  }
+
+  // eslint-disable-next-line @typescript-eslint/naming-convention
+  public _writev(chunks: Array<{ chunk: Buffer, encoding: string }>, callback: (error?: Error | null) => void): void {
+    let queued = 0;
+    for (let i = 0; i < chunks.length; i++) {
+      queued = this._channel.write(chunks[i].chunk);
+    }
+    this._queued(queued, callback);
+  }
+
+  private _queued(queued: number, callback: (error?: Error | null) => void): void {
+    // Holding the callback makes the stream buffer further writes and report backpressure until
+    // the native queue drained.
+    if (queued > this.writableHighWaterMark) {
+      this._pendingWriteCallback = callback;
+    } else {
+      callback();
+    }
+  }
+
+  // eslint-disable-next-line @typescript-eslint/naming-convention
+  public _destroy(error: Error | null, callback: (error: Error | null) => void): void {
+    this._channel.close();
+    callback(error);
+  }
+}
@@ -4,12 +4,15 @@
  */
 
 import type { UnixTerminal } from './unixTerminal';
+import type { UnixChannel } from './unixChannel';
 import * as assert from 'assert';
 import * as cp from 'child_process';
 import * as path from 'path';
 import * as tty from 'tty';
 import * as fs from 'fs';
-import { constants } from 'os';
+import * as net from 'net';
+import * as zlib from 'zlib';
+import { constants, tmpdir } from 'os';
 import { pollUntil } from './testUtils.test';
 import { pid } from 'process';
 
@@ -76,6 +79,483 @@ if (process.platform !== 'win32') {
       });
     });
 
+    describe('useNativeIo', () => {
+      it('should default to utf8', (done) => {
+        const term = new UnixTerminal('/bin/bash', [ '-c', `cat "${FIXTURES_PATH}"` ], { useNativeIo: true });
+        term.on('data', (data) => {
+          assert.strictEqual(typeof data, 'string');
+          assert.strictEqual(data, 'æ');
+          done();
+        });
+      });
+      it('should coalesce output', (done) => {
+        const term = new UnixTerminal('/bin/bash', [ '-c', 'for i in $(seq 1 500); do echo line$i; done' ], {
+          useNativeIo: true,
+          outputFlushInterval: 20
+        });
+        let events = 0;
+        let buffer = '';
+        term.on('data', (data) => {
+          events++;
+          buffer += data;
+        });
+        term.on('exit', () => {
+          assert.ok(buffer.endsWith('line500\r\n'));
+          assert.ok(events < 50, `${events} data events for 500 lines`);
+          done();
+        });
+      });
+      it('should write to the pty', (done) => {
+        const term = new UnixTerminal('/bin/cat', [], { useNativeIo: true });
+        let buffer = '';
+        term.on('data', (data) => {
+          buffer += data;
+          if (buffer.indexOf('hello\r\n') !== -1) {
+            term.on('exit', () => done());
+            term.kill();
+          }
+        });
+        term.write('hello\r');
+      });
+      it('should batch many small writes', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'stty raw -echo; echo ready; exec cat' ], { useNativeIo: true });
+        const channel: UnixChannel = (<any>term)._socket;
+        let buffer = '';
+        term.on('data', (data) => {
+          buffer += data;
+          if (buffer === 'ready\n') {
+            buffer = '';
+            for (let i = 0; i < 1000; i++) {
+              term.write(`${i % 10}`);
+            }
+            assert.strictEqual(channel.queuedBytes, 1000);
+          } else if (buffer.length === 1000) {
+            assert.strictEqual(buffer, '0123456789'.repeat(100));
+            assert.strictEqual(channel.queuedBytes, 0);
+            term.on('exit', () => done());
+            term.kill();
+          }
+        });
+      });
+      it('should read raw output into pooled buffers', (done) => {
+        const term = new UnixTerminal('/bin/bash', [ '-c', `cat "${FIXTURES_PATH}"` ], {
+          useNativeIo: true,
+          encoding: null,
+          outputBufferPoolSize: 2
+        });
+        term.on('data', (data) => {
+          assert.ok(Buffer.isBuffer(data));
+          assert.strictEqual(data.buffer.byteLength, 65536);
+          assert.deepStrictEqual(Array.prototype.slice.call(data), [0xC3, 0xA6]);
+          term.releaseBuffer(data);
+          done();
+        });
+      });
+      it('should only cut utf8 output at code point boundaries', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', `printf 'a\\303'; sleep 0.2; printf '\\246\\342\\202'; sleep 0.2; printf '\\254'` ], {
+          useNativeIo: true,
+          outputFlushInterval: 0
+        });
+        const chunks: string[] = [];
+        term.on('data', (data) => {
+          chunks.push(data);
+        });
+        term.on('exit', () => {
+          assert.deepStrictEqual(chunks, ['a', 'æ', '€']);
+          done();
+        });
+      });
+      it('should stop reading at the flow control high watermark until acked', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'head -c 1000000 /dev/zero | tr "\\0" x' ], {
+          useNativeIo: true,
+          encoding: null,
+          outputFlushSize: 16384,
+          flowControlHighWatermark: 65536
+        });
+        let received = 0;
+        term.on('data', (data) => {
+          received += data.length;
+        });
+        setTimeout(() => {
+          // At most one flush past the watermark
+          assert.ok(received >= 65536 && received < 65536 + 16384, `${received} bytes read`);
+          term.on('exit', () => {
+            assert.strictEqual(received, 1000000);
+            done();
+          });
+          term.on('data', () => term.ack());
+          term.ack();
+        }, 500);
+      });
+    });
+
+    describe('useIoThread', () => {
+      it('should read and write the pty from an I/O thread', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'stty raw -echo; echo ready; exec cat' ], { useIoThread: true });
+        const channel: UnixChannel = (<any>term)._socket;
+        let buffer = '';
+        term.on('data', (data) => {
+          buffer += data;
+          if (buffer === 'ready\n') {
+            buffer = '';
+            for (let i = 0; i < 1000; i++) {
+              term.write(`${i % 10}`);
+            }
+            assert.ok(channel.queuedBytes > 0);
+          } else if (buffer.length === 1000) {
+            assert.strictEqual(buffer, '0123456789'.repeat(100));
+            term.on('exit', () => done());
+            term.kill();
+          }
+        });
+      });
+      it('should spread ptys over the thread pool', (done) => {
+        UnixTerminal.setIoThreadPoolSize(2);
+        let exits = 0;
+        for (let i = 0; i < 4; i++) {
+          const term = new UnixTerminal('/bin/sh', [ '-c', `echo pty${i}` ], { useIoThread: true });
+          let buffer = '';
+          term.on('data', (data) => {
+            buffer += data;
+          });
+          term.on('exit', () => {
+            assert.strictEqual(buffer, `pty${i}\r\n`);
+            if (++exits === 4) {
+              UnixTerminal.setIoThreadPoolSize(1);
+              done();
+            }
+          });
+        }
+      });
+    });
+
+    if (process.platform === 'linux') {
+      describe('transfer', () => {
+        it('should hand the pty over with its exit', (done) => {
+          const term = new UnixTerminal('/bin/sh', [ '-c', 'read x; echo got $x; exit 3' ]);
+          const handle = term.transfer();
+          assert.strictEqual(handle.pid, term.pid);
+          const adopted = UnixTerminal.adopt(handle);
+          let buffer = '';
+          adopted.on('data', (data) => {
+            buffer += data;
+          });
+          adopted.on('exit', (code) => {
+            assert.ok(buffer.includes('got hello'));
+            assert.strictEqual(code, 3);
+            done();
+          });
+          adopted.write('hello\r');
+        });
+        it('should hold an exit until the pty is adopted', (done) => {
+          const term = new UnixTerminal('/bin/sh', [ '-c', 'exit 4' ]);
+          const handle = term.transfer();
+          setTimeout(() => {
+            UnixTerminal.adopt(handle).on('exit', (code) => {
+              assert.strictEqual(code, 4);
+              done();
+            });
+          }, 200);
+        });
+        it('should be adopted by a worker thread', (done) => {
+          const term = new UnixTerminal('/bin/sh', [ '-c', 'read x; echo got $x; exit 5' ]);
+          const { Worker } = require('worker_threads');
+          const worker = new Worker(`
+            const { parentPort, workerData } = require('worker_threads');
+            const { UnixTerminal } = require(${JSON.stringify(path.join(__dirname, 'unixTerminal'))});
+            const term = UnixTerminal.adopt(workerData);
+            let buffer = '';
+            term.on('data', data => buffer += data);
+            term.on('exit', code => parentPort.postMessage({ buffer, code }));
+            term.write('hello\\r');
+          `, { eval: true, workerData: term.transfer() });
+          worker.on('message', (result: { buffer: string, code: number }) => {
+            assert.ok(result.buffer.includes('got hello'));
+            assert.strictEqual(result.code, 5);
+            worker.terminate().then(() => done());
+          });
+        });
+      });
+    }
+
+    describe('snapshot', () => {
+      it('should keep the latest output natively', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'head -c 100 /dev/zero | tr "\\0" a; printf 0123456789' ], { scrollbackSize: 16 });
+        term.on('exit', () => {
+          assert.deepStrictEqual(term.snapshot(), { offset: 94, data: 'aaaaaa0123456789' });
+          assert.deepStrictEqual(term.snapshot(105), { offset: 105, data: '56789' });
+          assert.deepStrictEqual(term.snapshot(10), { offset: 94, data: 'aaaaaa0123456789' });
+          assert.deepStrictEqual(term.snapshot(200), { offset: 110, data: '' });
+          done();
+        });
+      });
+    });
+
+    describe('onOutput', () => {
+      it('should tag output with contiguous byte offsets matching the scrollback', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'head -c 300000 /dev/zero | tr "\\0" a; printf é' ], { scrollbackSize: 1024 });
+        let bytes = 0;
+        let data = '';
+        term.onOutput(e => {
+          assert.strictEqual(e.offset, bytes);
+          bytes += Buffer.byteLength(e.data);
+          data += e.data;
+        });
+        term.onExit(() => {
+          assert.strictEqual(bytes, 300002);
+          const snapshot = term.snapshot(bytes - 2);
+          assert.deepStrictEqual(snapshot, { offset: bytes - 2, data: 'é' });
+          assert.strictEqual(data.slice(-1), 'é');
+          done();
+        });
+      });
+
+      it('should count the bytes of the pty, not of the decoded text', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'printf é; sleep 0.1; printf x' ], { useNativeIo: true, encoding: 'latin1' });
+        const events: Array<{ data: string | Buffer, offset: number }> = [];
+        term.onOutput(e => events.push(e));
+        term.onExit(() => {
+          assert.deepStrictEqual(events, [ { data: '\u00c3\u00a9', offset: 0 }, { data: 'x', offset: 2 } ]);
+          done();
+        });
+      });
+      it('should tag a character split between chunks with the offset it starts at', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'printf x; printf \'\\303\'; sleep 0.1; printf \'\\251y\'' ], { useNativeIo: true, encoding: null });
+        // Decoded in JS, not natively
+        term.setEncoding('utf8');
+        const events: Array<{ data: string | Buffer, offset: number }> = [];
+        term.onOutput(e => events.push(e));
+        term.onExit(() => {
+          assert.deepStrictEqual(events, [ { data: 'x', offset: 0 }, { data: '\u00e9y', offset: 1 } ]);
+          done();
+        });
+      });
+    });
+
+    describe('setMatchPatterns', () => {
+      it('should report the byte offset of every pattern in the output', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'printf "é\\033]133;A\\007$ ready\\033]133;A\\007"' ], { useNativeIo: true });
+        term.setMatchPatterns([ '\x1b]133;A\x07', 'ready' ]);
+        const matches: Array<{ pattern: number, offset: number }> = [];
+        term.onMatch(e => matches.push(e));
+        term.on('exit', () => {
+          assert.deepStrictEqual(matches, [
+            { pattern: 0, offset: 2 },
+            { pattern: 1, offset: 12 },
+            { pattern: 0, offset: 17 }
+          ]);
+          done();
+        });
+      });
+    });
+
+    describe('setPlainTextTap', () => {
+      const output = 'printf "\\033]0;title\\007\\033[1;31mred\\033[0m plain\\n"';
+      it('should pass the output without escape sequences', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', output ], { useNativeIo: true });
+        let text = '';
+        term.setPlainTextTap(chunk => text += chunk);
+        term.on('exit', () => {
+          assert.strictEqual(text, 'red plain\n');
+          done();
+        });
+      });
+      it('should write the output without escape sequences to an fd', (done) => {
+        const file = path.join(tmpdir(), `node-pty-plain-${process.pid}.txt`);
+        const fd = fs.openSync(file, 'w');
+        const term = new UnixTerminal('/bin/sh', [ '-c', output ], { useNativeIo: true });
+        term.setPlainTextTap(fd);
+        // The tap writes to a copy of the fd off the event loop
+        fs.closeSync(fd);
+        term.on('exit', () => {
+          const interval = setInterval(() => {
+            if (fs.readFileSync(file, 'utf8') === 'red plain\n') {
+              clearInterval(interval);
+              fs.unlinkSync(file);
+              done();
+            }
+          }, 10);
+        });
+      });
+    });
+
+    describe('startRecording', () => {
+      it('should record output and input as asciicast', (done) => {
+        const file = path.join(tmpdir(), `node-pty-recording-${process.pid}.cast`);
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'read x; printf "got %s" "$x"' ], { useNativeIo: true, cols: 100, rows: 30 });
+        term.startRecording(file, { input: true });
+        term.write('abc\n');
+        term.on('exit', () => {
+          // Written off the event loop once the recording stopped
+          const interval = setInterval(() => {
+            if (fs.readFileSync(file, 'utf8').indexOf('got abc') !== -1) {
+              clearInterval(interval);
+              check();
+            }
+          }, 10);
+        });
+        const check = () => {
+          const lines = fs.readFileSync(file, 'utf8').trim().split('\n').map(line => JSON.parse(line));
+          fs.unlinkSync(file);
+          assert.strictEqual(lines[0].version, 2);
+          assert.strictEqual(lines[0].width, 100);
+          assert.strictEqual(lines[0].height, 30);
+          const events: Array<[number, string, string]> = lines.slice(1);
+          assert.deepStrictEqual(events.filter(e => e[1] === 'i').map(e => e[2]), [ 'abc\n' ]);
+          assert.ok(events.filter(e => e[1] === 'o').map(e => e[2]).join('').endsWith('got abc'));
+          done();
+        };
+      });
+    });
+
+    describe('setCompressionTap', () => {
+      it('should pass deflated frames that inflate to the output', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'for i in 1 2 3 4 5 6 7 8; do printf "\\033[2J\\033[Hredraw\\n"; sleep 0.01; done' ], { useNativeIo: true, encoding: null });
+        const frames: Buffer[] = [];
+        let output = Buffer.alloc(0);
+        let offset = 0;
+        term.setCompressionTap(frame => {
+          assert.strictEqual(frame.offset, offset);
+          offset += frame.length;
+          frames.push(frame.data);
+        });
+        term.on('data', (data: Buffer) => output = Buffer.concat([output, data]));
+        term.on('exit', () => {
+          assert.strictEqual(offset, output.length);
+          assert.deepStrictEqual(zlib.inflateRawSync(Buffer.concat(frames), { finishFlush: zlib.constants.Z_SYNC_FLUSH }), output);
+          done();
+        });
+      });
+    });
+
+    describe('forward', () => {
+      it('should relay output and input through a socket', (done) => {
+        const socketPath = path.join(tmpdir(), `node-pty-forward-${pid}.sock`);
+        // Paused so that only the relay reads the connection
+        const server = net.createServer({ pauseOnConnect: true }, connection => {
+          const term = new UnixTerminal('/bin/sh', [ '-c', 'stty -echo; echo ready; read line; echo "got $line"' ], { useNativeIo: true });
+          term.forward((connection as any)._handle.fd).then(() => {
+            connection.destroy();
+            server.close();
+          }, done);
+        });
+        server.listen(socketPath, () => {
+          const client = net.connect(socketPath);
+          let output = '';
+          client.on('data', data => {
+            output += data;
+            if (output === 'ready\r\n') {
+              client.write('hello\n');
+            }
+          });
+          client.on('end', () => {
+            assert.strictEqual(output, 'ready\r\ngot hello\r\n');
+            done();
+          });
+        });
+      });
+    });
+
+    describe('paste', () => {
+      it('should write every byte of a large paste in canonical mode', (done) => {
+        const term = new UnixTerminal('/bin/sh', [ '-c', 'stty -echo; echo ready; wc -c' ]);
+        const line = 'x'.repeat(49) + '\n';
+        const data = line.repeat(2000);
+        let buffer = '';
+        let progress = 0;
+        let pasted = false;
+        term.on('data', (chunk) => {
+          buffer += chunk;
+          if (!pasted && buffer.includes('ready\r\n')) {
+            pasted = true;
+            term.paste(data, { onProgress: (bytesWritten, totalBytes) => {
+              assert.strictEqual(totalBytes, data.length);
+              progress = bytesWritten;
+            }}).then(() => term.write('\x04'), done);
+          }
+        });
+        term.on('exit', () => {
+          assert.strictEqual(progress, data.length);
+          assert.strictEqual(buffer.trim().split(/\s+/).pop(), String(data.length));
+          done();
+        });
+      });
+    });
+
+    describe('spawnAsync', () => {
+      it('should resolve with a running terminal', async () => {
+        const term = await UnixTerminal.spawnAsync('/bin/sh', ['-c', 'echo async; exit 5']);
+        assert.ok(term.pid > 0);
+        assert.ok(tty.isatty(term.fd));
+        let buffer = '';
+        term.on('data', (data) => {
+          buffer += data;
+        });
+        const code = await new Promise(resolve => term.on('exit', resolve));
+        assert.strictEqual(buffer, 'async\r\n');
+        assert.strictEqual(code, 5);
+      });
+      it('should reject invalid options', async () => {
+        await assert.rejects(UnixTerminal.spawnAsync('/bin/sh', [], { cwd: <any>1 }), /cwd must be a string/);
+      });
+    });
+
+    describe('forkMany', () => {
+      it('should spawn every spec and report errors per spec', async () => {
+        const env = { FOO: 'foo' };
+        const results = UnixTerminal.forkMany([
+          { file: '/bin/sh', args: ['-c', 'echo $FOO $PWD; exit 1'], options: { env, cwd: '/' } },
+          { file: '/bin/sh', args: [], options: { cwd: <any>1 } },
+          { file: '/bin/sh', args: [], options: { spawnMethod: <any>'bogus' } },
+          { file: '/bin/sh', args: ['-c', 'echo $FOO $TERM; exit 2'], options: { env, name: 'vt100' } }
+        ]);
+        assert.strictEqual(results.length, 4);
+        assert.ok(results[1] instanceof Error);
+        assert.ok(/cwd must be a string/.test((<Error>results[1]).message));
+        assert.ok(results[2] instanceof Error);
+        assert.ok(/Unsupported spawnMethod: bogus/.test((<Error>results[2]).message));
+
+        const output = (term: UnixTerminal): Promise<[string, number]> => new Promise(resolve => {
+          let buffer = '';
+          term.on('data', (data) => {
+            buffer += data;
+          });
+          term.on('exit', code => resolve([buffer, code]));
+        });
+        const outputs = await Promise.all([output(<UnixTerminal>results[0]), output(<UnixTerminal>results[3])]);
+        assert.deepStrictEqual(outputs, [['foo /\r\n', 1], ['foo vt100\r\n', 2]]);
+      });
+
+      it('should only fail the specs using an environment that can not be parsed', async () => {
+        // Not an EnvBlock created by node-pty
+        const envBlock = <any>{ env: { FOO: 'foo' }, native: {} };
+        const results = UnixTerminal.forkMany([
+          { file: '/bin/sh', args: [], options: { envBlock } },
+          { file: '/bin/sh', args: ['-c', 'exit 3'], options: {} }
+        ]);
+        assert.ok(results[0] instanceof Error);
+        const code = await new Promise(resolve => (<UnixTerminal>results[1]).on('exit', resolve));
+        assert.strictEqual(code, 3);
+      });
+    });
+
+    describe('createEnvBlock', () => {
+      it('should spawn many terminals from one environment', async () => {
+        const envBlock = UnixTerminal.createEnvBlock({ FOO: 'foo', PWD: '/nowhere', TERM: 'dumb' });
+        const output = (cwd: string, name?: string): Promise<string> => new Promise(resolve => {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'echo $FOO $PWD $TERM'], { envBlock, cwd, name });
+          let buffer = '';
+          term.on('data', (data) => {
+            buffer += data;
+          });
+          term.on('exit', () => resolve(buffer));
+        });
+        assert.deepStrictEqual(await Promise.all([output('/'), output('/tmp', 'vt100')]), ['foo / dumb\r\n', 'foo /tmp vt100\r\n']);
+        // The block is not changed by the overrides
+        assert.deepStrictEqual(envBlock.env, { FOO: 'foo', PWD: '/nowhere', TERM: 'dumb' });
+      });
+    });
+
     describe('open', () => {
       let term: UnixTerminal;
 
@@ -258,6 +738,65 @@ if (process.platform !== 'win32') {
       });
     });
     describe('spawn', () => {
+      if (process.platform === 'linux') {
+        it('should follow the foreground process through exec', (done) => {
+          const term = new UnixTerminal('/bin/sh', [ '-c', 'echo ready; read x; exec /bin/sleep 5' ]);
+          let buffer = '';
+          let ready = false;
+          term.on('data', (data) => {
+            buffer += data;
+            if (ready || !buffer.includes('ready\r\n')) {
+              return;
+            }
+            ready = true;
+            assert.strictEqual(term.process, '/bin/sh');
+            // Same process group, another program
+            term.write('\n');
+            const interval = setInterval(() => {
+              if (term.process === '/bin/sleep') {
+                clearInterval(interval);
+                term.on('exit', () => done());
+                term.kill('SIGKILL');
+              }
+            }, 20);
+          });
+        });
+      }
+      it('should notify when the foreground process group changes', (done) => {
+        // An interactive shell runs every command in a process group of its own
+        const term = new UnixTerminal('/bin/sh', [ '-i' ]);
+        const groups: number[] = [];
+        term.onProcessChange(e => {
+          groups.push(e.pgrp);
+          if (groups.length === 1) {
+            // Found without output from the command
+            assert.notStrictEqual(e.pgrp, term.pid);
+          } else if (groups.length === 2) {
+            assert.strictEqual(e.pgrp, term.pid);
+            term.on('exit', () => done());
+            term.kill('SIGKILL');
+          }
+        });
+        term.write('/bin/sleep 1\n');
+      });
+      if (process.platform === 'linux') {
+        it('should query many foreground processes at once', (done) => {
+          const term = new UnixTerminal('/bin/sh', [ '-c', 'echo ready; exec /bin/sleep 5' ]);
+          term.on('data', (data) => {
+            if (!data.includes('ready')) {
+              return;
+            }
+            UnixTerminal.processMany([ term ]).then(processes => {
+              assert.strictEqual(processes.length, 1);
+              assert.strictEqual(processes[0]!.pgrp, term.pid);
+              assert.strictEqual(processes[0]!.name, '/bin/sleep');
+              assert.deepStrictEqual(processes[0]!.argv, [ '/bin/sleep', '5' ]);
+              term.on('exit', () => done());
+              term.kill('SIGKILL');
+            }).catch(done);
+          });
+        });
+      }
       if (process.platform === 'darwin') {
         it('should return the name of the process', (done) => {
           const term = new UnixTerminal('/bin/echo');
@@ -352,6 +891,72 @@ if (process.platform !== 'win32') {
           done();
         });
       });
+      if (process.platform === 'linux') {
+        it('should not create a thread per pty', (done) => {
+          const threadCount = (): number => fs.readdirSync('/proc/self/task').length;
+          const before = threadCount();
+          const terms: UnixTerminal[] = [];
+          for (let i = 0; i < 20; i++) {
+            terms.push(new UnixTerminal('/bin/sh', ['-c', 'sleep 0.2']));
+          }
+          // At most the shared reaper thread was started
+          assert.ok(threadCount() <= before + 1, `${threadCount() - before} threads were started`);
+          let exited = 0;
+          for (const term of terms) {
+            term.on('exit', () => {
+              if (++exited === terms.length) {
+                done();
+              }
+            });
+          }
+        });
+        it('should make the pty the controlling terminal', (done) => {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'tty; exit 2']);
+          let buffer = '';
+          term.on('data', (data) => {
+            buffer += data;
+          });
+          term.on('exit', (code) => {
+            assert.strictEqual(buffer, `${term.ptsName}\r\n`);
+            assert.strictEqual(code, 2);
+            done();
+          });
+        });
+        it('should spawn with forkpty', (done) => {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'tty; exit 2'], { spawnMethod: 'forkpty' });
+          let buffer = '';
+          term.on('data', (data) => {
+            buffer += data;
+          });
+          term.on('exit', (code) => {
+            assert.strictEqual(buffer, `${term.ptsName}\r\n`);
+            assert.strictEqual(code, 2);
+            done();
+          });
+        });
+        it('should spawn through the zygote', (done) => {
+          const term = new UnixTerminal('/bin/sh', ['-c', 'echo $FOO; exit 3'], {
+            env: { FOO: 'zygote' },
+            spawnMethod: 'zygote'
+          });
+          let buffer = '';
+          term.on('data', (data) => {
+            buffer += data;
+          });
+          term.on('exit', (code) => {
+            assert.strictEqual(buffer, 'zygote\r\n');
+            assert.strictEqual(code, 3);
+            done();
+          });
+        });
+        it('should handle chdir() errors in the zygote', (done) => {
+          const term = new UnixTerminal('/bin/echo', [], { cwd: '/nowhere', spawnMethod: 'zygote' });
+          term.on('exit', (code) => {
+            assert.strictEqual(code, 1);
+            done();
+          });
+        });
+      }
       it('should not leak child process', (done) => {
         const count = cp.execSync('ps -ax | grep node | wc -l');
         const term = new UnixTerminal('node', [ '-e', `
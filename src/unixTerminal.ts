@@ -3,28 +3,110 @@
  * Copyright (c) 2016, Daniel Imms (MIT License).
  * Copyright (c) 2018, Microsoft Corporation (MIT License).
  */
+import * as fs from 'fs';
 import * as net from 'net';
 import * as path from 'path';
 import * as tty from 'tty';
+import { PassThrough } from 'stream';
 import { Terminal, DEFAULT_COLS, DEFAULT_ROWS } from './terminal';
-import { IProcessEnv, IPtyForkOptions, IPtyOpenOptions } from './interfaces';
+import { ICompressedFrame, IEnvBlock, IForegroundProcess, IForkSpec, IPasteOptions, IProcessEnv, IPtyForkOptions, IPtyHandle, IPtyOpenOptions, IRecordingOptions, ISnapshot } from './interfaces';
 import { ArgvOrCommandLine } from './types';
 import { assign } from './utils';
 import { requireBinary } from './requireBinary';
+import { UnixChannel } from './unixChannel';
 
 const pty = requireBinary<IUnixNative>('pty.node');
-let helperPath = `@lydell/node-pty-${process.platform}-${process.arch}/spawn-helper`;
-helperPath = process.platform === 'darwin' ? require.resolve(helperPath) : 'spawn-helper-unused';
-helperPath = helperPath.replace('app.asar', 'app.asar.unpacked');
-helperPath = helperPath.replace('node_modules.asar', 'node_modules.asar.unpacked');
+
+function resolveHelper(name: string): string {
+  let helperPath = require.resolve(`@lydell/node-pty-${process.platform}-${process.arch}/${name}`);
+  helperPath = helperPath.replace('app.asar', 'app.asar.unpacked');
+  helperPath = helperPath.replace('node_modules.asar', 'node_modules.asar.unpacked');
+  return helperPath;
+}
+
+const helperPath = process.platform === 'darwin' ? resolveHelper('spawn-helper') : 'spawn-helper-unused';
+let zygotePath: string | undefined;
+
+function getZygotePath(): string {
+  if (process.platform !== 'linux') {
+    throw new Error('The spawn zygote is only supported on Linux.');
+  }
+  if (!zygotePath) {
+    zygotePath = resolveHelper('spawn-zygote');
+  }
+  return zygotePath;
+}
+
+/**
+ * Copies `env`, without the variables of the parent terminal if it is `process.env`.
+ */
+function copyEnv(env: IProcessEnv): IProcessEnv {
+  const copy: IProcessEnv = assign({}, env);
+  if (env === process.env) {
+    sanitizeEnv(copy);
+  }
+  return copy;
+}
+
+function sanitizeEnv(env: IProcessEnv): void {
+  // Make sure we didn't start our server from inside tmux.
+  delete env['TMUX'];
+  delete env['TMUX_PANE'];
+
+  // Make sure we didn't start our server from inside screen.
+  // http://web.mit.edu/gnu/doc/html/screen_20.html
+  delete env['STY'];
+  delete env['WINDOW'];
+
+  // Delete some variables that might confuse our terminal.
+  delete env['WINDOWID'];
+  delete env['TERMCAP'];
+  delete env['COLUMNS'];
+  delete env['LINES'];
+}
 
 const DEFAULT_FILE = 'sh';
 const DEFAULT_NAME = 'xterm';
 const DESTROY_SOCKET_TIMEOUT_MS = 200;
+// Half of the 4 KB line discipline buffer, leaving room for a line in progress
+const DEFAULT_PASTE_CHUNK_SIZE = 2048;
+const PASTE_POLL_INTERVAL_MS = 1;
+const PASTE_MAX_POLL_INTERVAL_MS = 64;
+const BRACKETED_PASTE_START = '\x1b[200~';
+const BRACKETED_PASTE_END = '\x1b[201~';
+
+/**
+ * Passed to the constructor by `spawnAsync` to fork on a worker thread,
+ * `ready` settles once the process is running. `forkMany` passes a `batch`
+ * instead, the constructor then queues its fork in it. `adopt` passes the
+ * `handle` of a running pty, which is taken over instead of forking.
+ */
+interface IPendingFork {
+  ready?: Promise<void>;
+  batch?: IForkBatch;
+  handle?: IPtyHandle;
+}
+
+interface IForkBatch {
+  // Parsed once per `env` or `envBlock` option however many terminals share it
+  parsedEnvs: Array<string[] | IUnixNativeEnvBlock>;
+  envIndices: Map<object, number>;
+  specs: IUnixForkSpec[];
+  // Completes the terminal of the spec at the same index
+  setups: Array<(term: IUnixProcess) => void>;
+}
+
+/**
+ * Returned by `createEnvBlock`, the native block is created by the first
+ * terminal spawned from it.
+ */
+interface IUnixEnvBlock extends IEnvBlock {
+  native?: IUnixNativeEnvBlock;
+}
 
 export class UnixTerminal extends Terminal {
-  protected _fd: number;
-  protected _pty: string;
+  protected _fd!: number; // Set once forked
+  protected _pty!: string; // Set once forked
 
   protected _file: string;
   protected _name: string;
@@ -40,7 +122,7 @@ export class UnixTerminal extends Terminal {
   public get master(): net.Socket | undefined { return this._master; }
   public get slave(): net.Socket | undefined { return this._slave; }
 
-  constructor(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions) {
+  constructor(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions, pendingFork?: IPendingFork) {
     super(opt);
 
     if (typeof args === 'string') {
@@ -53,25 +135,30 @@ export class UnixTerminal extends Terminal {
     opt = opt || {};
     opt.env = opt.env || process.env;
 
+    this._checkType('outputFlushInterval', opt.outputFlushInterval, 'number');
+    this._checkType('outputFlushSize', opt.outputFlushSize, 'number');
+    this._checkType('outputBufferPoolSize', opt.outputBufferPoolSize, 'number');
+    this._checkType('flowControlHighWatermark', opt.flowControlHighWatermark, 'number');
+    this._checkType('flowControlLowWatermark', opt.flowControlLowWatermark, 'number');
+    this._checkType('scrollbackSize', opt.scrollbackSize, 'number');
+    this._checkType('spawnMethod', opt.spawnMethod, 'string');
+
     this._cols = opt.cols || DEFAULT_COLS;
     this._rows = opt.rows || DEFAULT_ROWS;
     const uid = opt.uid ?? -1;
     const gid = opt.gid ?? -1;
-    const env: IProcessEnv = assign({}, opt.env);
-
-    if (opt.env === process.env) {
-      this._sanitizeEnv(env);
-    }
-
     const cwd = opt.cwd || process.cwd();
-    env.PWD = cwd;
-    const name = opt.name || env.TERM || DEFAULT_NAME;
-    env.TERM = name;
-    const parsedEnv = this._parseEnv(env);
+    const envBlock = <IUnixEnvBlock | undefined>opt.envBlock;
+    const name = opt.name || (envBlock ? envBlock.env : opt.env).TERM || DEFAULT_NAME;
+    // Applied natively on top of the parsed environment, which can then be shared
+    const envOverrides = [`PWD=${cwd}`, `TERM=${name}`];
 
     const encoding = (opt.encoding === undefined ? 'utf8' : opt.encoding);
 
     const onexit = (code: number, signal: number): void => {
+      // Lets pastes close the slave, which keeps the pty from hanging up
+      this._internalee.emit('processExit');
+      pty.forgetProcess(this._fd);
       // XXX Sometimes a data event is emitted after exit. Wait til socket is
       // destroyed.
       if (!this._emittedClose) {
@@ -99,9 +186,139 @@ export class UnixTerminal extends Terminal {
     };
 
     // fork
-    const term = pty.fork(file, args, parsedEnv, cwd, this._cols, this._rows, uid, gid, (encoding === 'utf8'), helperPath, onexit);
+    const spawnMethod = opt.spawnMethod || 'default';
+    const forkHelperPath = spawnMethod === 'zygote' ? getZygotePath() : helperPath;
+    if (pendingFork && pendingFork.handle) {
+      const handle = pendingFork.handle;
+      pty.adopt(handle.pid, onexit);
+      this._setupPty({ fd: handle.fd, pid: handle.pid, pty: handle.pty }, opt, encoding);
+    } else if (pendingFork && pendingFork.batch) {
+      const batch = pendingFork.batch;
+      const envKey = envBlock || opt.env;
+      let envIndex = batch.envIndices.get(envKey);
+      if (envIndex === undefined) {
+        envIndex = batch.parsedEnvs.push(this._forkEnv(envBlock, opt.env)) - 1;
+        batch.envIndices.set(envKey, envIndex);
+      }
+      batch.specs.push({
+        file, args, env: envIndex, envOverrides, cwd, cols: this._cols, rows: this._rows,
+        uid, gid, utf8: (encoding === 'utf8'), helperPath: forkHelperPath, spawnMethod, onexit
+      });
+      batch.setups.push(term => this._setupPty(term, opt!, encoding));
+    } else {
+      const env = this._forkEnv(envBlock, opt.env);
+      if (pendingFork) {
+        pendingFork.ready = pty.forkAsync(file, args, env, envOverrides, cwd, this._cols, this._rows, uid, gid, (encoding === 'utf8'), forkHelperPath, spawnMethod, onexit)
+          .then(term => this._setupPty(term, opt!, encoding));
+      } else {
+        const term = pty.fork(file, args, env, envOverrides, cwd, this._cols, this._rows, uid, gid, (encoding === 'utf8'), forkHelperPath, spawnMethod, onexit);
+        this._setupPty(term, opt, encoding);
+      }
+    }
+
+    this._file = file;
+    this._name = name;
+
+    this._readable = true;
+    this._writable = true;
+  }
 
-    this._socket = new tty.ReadStream(term.fd);
+  /**
+   * Forks like the constructor, but does all the work of starting the process on a worker thread.
+   */
+  public static spawnAsync(file?: string, args?: ArgvOrCommandLine, opt?: IPtyForkOptions): Promise<UnixTerminal> {
+    const pendingFork: IPendingFork = {};
+    let term: UnixTerminal;
+    try {
+      term = new UnixTerminal(file, args, opt, pendingFork);
+    } catch (e) {
+      return Promise.reject(e);
+    }
+    return pendingFork.ready!.then(() => term);
+  }
+
+  /**
+   * Spawns many terminals in a single native call, terminals with the same `env` option share
+   * its parsed copy. Returns the terminal or the Error of each spec, in order.
+   */
+  public static forkMany(specs: IForkSpec[]): Array<UnixTerminal | Error> {
+    const batch: IForkBatch = { parsedEnvs: [], envIndices: new Map(), specs: [], setups: [] };
+    const results: Array<UnixTerminal | Error> = [];
+    // The index in results of each spec in the batch
+    const queued: number[] = [];
+    for (let i = 0; i < specs.length; i++) {
+      try {
+        results.push(new UnixTerminal(specs[i].file, specs[i].args, specs[i].options, { batch }));
+        queued.push(i);
+      } catch (e) {
+        results.push(e);
+      }
+    }
+    const terms = pty.forkMany(batch.parsedEnvs, batch.specs);
+    for (let i = 0; i < terms.length; i++) {
+      const term = terms[i];
+      if ('error' in term) {
+        results[queued[i]] = new Error(term.error);
+      } else {
+        batch.setups[i](term);
+      }
+    }
+    return results;
+  }
+
+  /**
+   * Takes over a pty handed over by `transfer`, usually on another thread.
+   */
+  public static adopt(handle: IPtyHandle, opt?: IPtyForkOptions): UnixTerminal {
+    opt = assign({}, opt, { name: handle.name, cols: handle.cols, rows: handle.rows });
+    return new UnixTerminal(handle.file, [], opt, { handle });
+  }
+
+  /**
+   * Queries the foreground process of every terminal in a single native call, off the event loop.
+   */
+  public static processMany(terms: UnixTerminal[]): Promise<Array<IForegroundProcess | null>> {
+    return pty.processMany(terms.map(term => term._fd));
+  }
+
+  /**
+   * Copies and parses `env` once per environment block, so that many terminals can be spawned from
+   * it without doing so each time.
+   */
+  public static createEnvBlock(env?: IProcessEnv): IEnvBlock {
+    const block: IUnixEnvBlock = { env: copyEnv(env || process.env) };
+    return block;
+  }
+
+  /**
+   * Returns the environment to pass to `fork`, without PWD and TERM.
+   */
+  private _forkEnv(envBlock: IUnixEnvBlock | undefined, env: IProcessEnv): string[] | IUnixNativeEnvBlock {
+    if (!envBlock) {
+      return this._parseEnv(copyEnv(env));
+    }
+    if (!envBlock.native) {
+      envBlock.native = new pty.EnvBlock(this._parseEnv(envBlock.env));
+    }
+    return envBlock.native;
+  }
+
+  private _setupPty(term: IUnixProcess, opt: IPtyForkOptions, encoding: string | null): void {
+    if (opt.useNativeIo || opt.useIoThread || opt.scrollbackSize) {
+      this._socket = <any>new UnixChannel(term.fd, {
+        flushInterval: opt.outputFlushInterval,
+        flushSize: opt.outputFlushSize,
+        // Pooled buffers are only handed out as raw bytes, and not from an I/O thread
+        poolSize: encoding === null && !opt.useIoThread ? opt.outputBufferPoolSize : 0,
+        highWatermark: opt.flowControlHighWatermark,
+        lowWatermark: opt.flowControlLowWatermark,
+        utf8: encoding === 'utf8',
+        thread: !!opt.useIoThread,
+        scrollback: opt.scrollbackSize
+      });
+    } else {
+      this._socket = new tty.ReadStream(term.fd);
+    }
     if (encoding !== null) {
       this._socket.setEncoding(encoding);
     }
@@ -143,12 +360,6 @@ export class UnixTerminal extends Terminal {
     this._fd = term.fd;
     this._pty = term.pty;
 
-    this._file = file;
-    this._name = name;
-
-    this._readable = true;
-    this._writable = true;
-
     this._socket.on('close', () => {
       if (this._emittedClose) {
         return;
@@ -165,10 +376,189 @@ export class UnixTerminal extends Terminal {
     this._socket.write(data);
   }
 
+  /**
+   * Writes `data` in chunks, each once the program read everything written before. This keeps a
+   * large paste from overflowing the line discipline's buffer, which in canonical mode drops input
+   * instead of blocking. Resolves once all of `data` was written.
+   */
+  public paste(data: Buffer | string | NodeJS.ReadableStream, options: IPasteOptions = {}): Promise<void> {
+    this._checkType('chunkSize', options.chunkSize, 'number');
+    const chunkSize = options.chunkSize || DEFAULT_PASTE_CHUNK_SIZE;
+    let totalBytes: number | undefined;
+    let source: NodeJS.ReadableStream;
+    if (typeof data === 'string' || Buffer.isBuffer(data)) {
+      const buffer = typeof data === 'string' ? Buffer.from(data) : data;
+      totalBytes = buffer.length;
+      const stream = new PassThrough();
+      stream.end(buffer);
+      source = stream;
+    } else {
+      source = data;
+    }
+
+    return new Promise<void>((resolve, reject) => {
+      let bytesWritten = 0;
+      let pending: Buffer | null = null;
+      let sourceEnded = false;
+      let waitingForSource = false;
+      let finished = false;
+      let timer: NodeJS.Timeout | undefined;
+      let interval = PASTE_POLL_INTERVAL_MS;
+      let slaveFd: number | undefined;
+
+      const closeSlave = (): void => {
+        this._internalee.removeListener('processExit', closeSlave);
+        if (slaveFd !== undefined) {
+          fs.closeSync(slaveFd);
+          slaveFd = undefined;
+        }
+      };
+
+      const onReadable = (): void => {
+        if (waitingForSource) {
+          waitingForSource = false;
+          pump();
+        }
+      };
+      const onEnd = (): void => {
+        sourceEnded = true;
+        onReadable();
+      };
+      const onError = (err: Error): void => finish(err);
+      const onExit = (): void => finish(new Error('The pty exited during the paste'));
+
+      const finish = (err?: Error): void => {
+        if (finished) {
+          return;
+        }
+        finished = true;
+        if (timer) {
+          clearTimeout(timer);
+        }
+        closeSlave();
+        source.removeListener('readable', onReadable);
+        source.removeListener('end', onEnd);
+        source.removeListener('error', onError);
+        this.removeListener('exit', onExit);
+        if (err) {
+          reject(err);
+          return;
+        }
+        if (options.bracketed) {
+          this._write(BRACKETED_PASTE_END);
+        }
+        resolve();
+      };
+
+      const nextChunk = (): Buffer | null => {
+        if (!pending || pending.length === 0) {
+          const chunk = source.read();
+          if (chunk === null) {
+            return null;
+          }
+          pending = typeof chunk === 'string' ? Buffer.from(chunk) : chunk;
+        }
+        const result = pending!.slice(0, chunkSize);
+        pending = pending!.slice(chunkSize);
+        return result;
+      };
+
+      const pump = (): void => {
+        timer = undefined;
+        if (finished) {
+          return;
+        }
+        if (slaveFd === undefined) {
+          // The pty is hanging up, its exit ends the paste
+          return;
+        }
+        let queued: number;
+        try {
+          queued = pty.inputQueue(slaveFd) + (this._socket instanceof UnixChannel ? this._socket.queuedBytes : this._socket.writableLength);
+        } catch (e) {
+          finish(e);
+          return;
+        }
+        if (queued > 0) {
+          // The program is still reading what was written so far, slow readers are polled less often
+          timer = setTimeout(pump, interval);
+          interval = Math.min(interval * 2, PASTE_MAX_POLL_INTERVAL_MS);
+          return;
+        }
+        interval = PASTE_POLL_INTERVAL_MS;
+        const chunk = nextChunk();
+        if (chunk === null) {
+          if (sourceEnded) {
+            finish();
+          } else {
+            waitingForSource = true;
+          }
+          return;
+        }
+        this._socket.write(chunk);
+        bytesWritten += chunk.length;
+        if (options.onProgress) {
+          options.onProgress(bytesWritten, totalBytes);
+        }
+        timer = setTimeout(pump, PASTE_POLL_INTERVAL_MS);
+      };
+
+      source.on('readable', onReadable);
+      source.on('end', onEnd);
+      source.on('error', onError);
+      this.once('exit', onExit);
+      try {
+        slaveFd = pty.openSlave(this._pty);
+      } catch (e) {
+        finish(e);
+        return;
+      }
+      this._internalee.once('processExit', closeSlave);
+      if (options.bracketed) {
+        this._write(BRACKETED_PASTE_START);
+      }
+      pump();
+    });
+  }
+
+  /**
+   * Acknowledges that `bytes` of output were consumed, all output so far without a count, see
+   * `IPtyForkOptions.flowControlHighWatermark`.
+   */
+  public ack(bytes?: number): void {
+    if (this._socket instanceof UnixChannel) {
+      this._socket.ack(bytes);
+    }
+  }
+
+  /**
+   * Hands a `data` Buffer back to the output buffer pool, see
+   * `IPtyForkOptions.outputBufferPoolSize`.
+   */
+  public releaseBuffer(data: Buffer): void {
+    if (this._socket instanceof UnixChannel) {
+      this._socket.release(data);
+    }
+  }
+
   /* Accessors */
   get fd(): number { return this._fd; }
   get ptsName(): string { return this._pty; }
 
+  /**
+   * Starts the helper process used by `spawnMethod: 'zygote'`.
+   */
+  public static startZygote(): void {
+    pty.startZygote(getZygotePath());
+  }
+
+  /**
+   * Sets the number of native I/O threads used by `useIoThread`.
+   */
+  public static setIoThreadPoolSize(size: number): void {
+    pty.setIoThreadPoolSize(size);
+  }
+
   /**
    * openpty
    */
@@ -228,6 +618,126 @@ export class UnixTerminal extends Terminal {
     return self;
   }
 
+  protected _outputOffset(data: string | Buffer): number | undefined {
+    // Counted natively, before decoding
+    if (this._socket instanceof UnixChannel) {
+      return this._socket.chunkOffset;
+    }
+    return super._outputOffset(data);
+  }
+
+  /**
+   * Returns the output kept with `scrollbackSize` from byte `offset` of all output on.
+   */
+  public snapshot(offset?: number): ISnapshot {
+    if (!(this._socket instanceof UnixChannel)) {
+      throw new Error('snapshot() requires the scrollbackSize option.');
+    }
+    return this._socket.snapshot(offset);
+  }
+
+  /**
+   * Scans all further output natively for `patterns`, see `onMatch`.
+   */
+  public setMatchPatterns(patterns: Array<string | Buffer>): void {
+    if (!(this._socket instanceof UnixChannel)) {
+      throw new Error('setMatchPatterns() requires the useNativeIo, useIoThread or scrollbackSize option.');
+    }
+    this._socket.match(patterns);
+  }
+
+  /**
+   * Passes a plain text copy of all further output to `target`, or writes it to `target` if it
+   * is an fd. Null stops it.
+   */
+  public setPlainTextTap(target: number | ((text: string | Buffer) => void) | null): void {
+    if (!(this._socket instanceof UnixChannel)) {
+      throw new Error('setPlainTextTap() requires the useNativeIo, useIoThread or scrollbackSize option.');
+    }
+    this._socket.plain(target === null ? undefined : target);
+  }
+
+  /**
+   * Passes deflated frames of all further output to `target`, or writes them to `target` as gzip
+   * if it is an fd. Null stops it.
+   */
+  public setCompressionTap(target: number | ((frame: ICompressedFrame) => void) | null, level?: number): void {
+    if (!(this._socket instanceof UnixChannel)) {
+      throw new Error('setCompressionTap() requires the useNativeIo, useIoThread or scrollbackSize option.');
+    }
+    if (target === null) {
+      this._socket.compress();
+    } else if (typeof target === 'number') {
+      this._socket.compress(target, level);
+    } else {
+      this._socket.compress((data, offset, length) => target({ data, offset, length }), level);
+    }
+  }
+
+  /**
+   * Records the session natively to a new file at `path` until `stopRecording`.
+   */
+  public startRecording(path: string, options?: IRecordingOptions): void {
+    if (!(this._socket instanceof UnixChannel)) {
+      throw new Error('startRecording() requires the useNativeIo, useIoThread or scrollbackSize option.');
+    }
+    this._socket.record(path, {
+      format: options && options.format,
+      input: !!(options && options.input),
+      cols: this._cols,
+      rows: this._rows
+    });
+  }
+
+  public stopRecording(): void {
+    if (this._socket instanceof UnixChannel) {
+      this._socket.stopRecording();
+    }
+  }
+
+  /**
+   * Relays between the pty and `targetFd` natively until either side closes, which closes the
+   * terminal.
+   */
+  public forward(targetFd: number): Promise<void> {
+    if (!(this._socket instanceof UnixChannel)) {
+      throw new Error('forward() requires the useNativeIo, useIoThread or scrollbackSize option.');
+    }
+    const socket = this._socket;
+    return new Promise<void>((resolve, reject) => {
+      socket.forward(targetFd, errorCode => {
+        // The relay read the pty to its end or hung up, either way the terminal is done
+        socket.destroy();
+        if (errorCode) {
+          const err: any = new Error(`forward ${errorCode}`);
+          err.code = errorCode;
+          reject(err);
+          return;
+        }
+        resolve();
+      });
+    });
+  }
+
+  /**
+   * Hands the pty over to be taken over with `adopt`, usually by a worker thread the handle is
+   * posted to. This terminal no longer emits any event and can't be used afterwards.
+   */
+  public transfer(): IPtyHandle {
+    if (!this._writable) {
+      throw new Error('The pty is closed.');
+    }
+    const fd = pty.detach(this._fd, this._pid);
+    // The socket closes the original fd, the pty stays open through the copy
+    this._socket.removeAllListeners();
+    this._socket.on('error', () => {});
+    this._internalee.removeAllListeners();
+    this._emittedClose = true;
+    this._close();
+    this._socket.destroy();
+    return { fd, pid: this._pid, pty: this._pty, file: this._file, name: this._name, cols: this._cols, rows: this._rows };
+  }
+
   public destroy(): void {
     this._close();
 
@@ -246,6 +756,27 @@ export class UnixTerminal extends Terminal {
     } catch (e) { /* swallow */ }
   }
 
+  protected _close(): void {
+    super._close();
+    // Before the socket closes the fd and its number can be reused
+    if (this._fd !== undefined) {
+      pty.forgetProcess(this._fd);
+    }
+  }
+
+  protected _getForegroundGroup(): number | undefined {
+    if (this._fd === undefined) {
+      // Still forking
+      return undefined;
+    }
+    const pgrp = pty.foregroundGroup(this._fd);
+    if (pgrp === 0 && this._pid > 0) {
+      // The child did not take the pty yet, it does so as the leader of a group of its own
+      return this._pid;
+    }
+    return pgrp <= 0 ? undefined : pgrp;
+  }
+
   /**
    * Gets the name of the process.
    */
@@ -255,7 +786,7 @@ export class UnixTerminal extends Terminal {
       return (title !== 'kernel_task' ) ? title : this._file;
     }
 
-    return pty.process(this._fd, this._pty) || this._file;
+    return pty.process(this._fd) || this._file;
   }
 
   /**
@@ -269,26 +800,12 @@ export class UnixTerminal extends Terminal {
     pty.resize(this._fd, cols, rows);
     this._cols = cols;
     this._rows = rows;
+    if (this._socket instanceof UnixChannel) {
+      this._socket.recordResize(cols, rows);
+    }
   }
 
   public clear(): void {
 
   }
-
-  private _sanitizeEnv(env: IProcessEnv): void {
-    // Make sure we didn't start our server from inside tmux.
-    delete env['TMUX'];
-    delete env['TMUX_PANE'];
-
-    // Make sure we didn't start our server from inside screen.
-    // http://web.mit.edu/gnu/doc/html/screen_20.html
-    delete env['STY'];
-    delete env['WINDOW'];
-
-    // Delete some variables that might confuse our terminal.
-    delete env['WINDOWID'];
-    delete env['TERMCAP'];
-    delete env['COLUMNS'];
-    delete env['LINES'];
-  }
 }
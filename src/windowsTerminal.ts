@@ -7,7 +7,7 @@
 import { Socket } from 'net';
 import { Terminal, DEFAULT_COLS, DEFAULT_ROWS } from './terminal';
 import { WindowsPtyAgent } from './windowsPtyAgent';
-import { IPtyOpenOptions, IWindowsPtyForkOptions } from './interfaces';
+import { ICompressedFrame, IEnvBlock, IForegroundProcess, IForkSpec, IPasteOptions, IProcessEnv, IPtyHandle, IPtyOpenOptions, IRecordingOptions, ISnapshot, IWindowsPtyForkOptions } from './interfaces';
 import { ArgvOrCommandLine } from './types';
 import { assign } from './utils';
 
@@ -139,6 +139,91 @@ export class WindowsTerminal extends Terminal {
     throw new Error('open() not supported on windows, use Fork() instead.');
   }
 
+  /**
+   * The conpty agent already starts the process off the event loop.
+   */
+  public static spawnAsync(file?: string, args?: ArgvOrCommandLine, opt?: IWindowsPtyForkOptions): Promise<WindowsTerminal> {
+    try {
+      return Promise.resolve(new WindowsTerminal(file, args, opt));
+    } catch (e) {
+      return Promise.reject(e);
+    }
+  }
+
+  public static forkMany(specs: IForkSpec[]): Array<WindowsTerminal | Error> {
+    return specs.map(spec => {
+      try {
+        return new WindowsTerminal(spec.file, spec.args, spec.options);
+      } catch (e) {
+        return e;
+      }
+    });
+  }
+
+  public static createEnvBlock(env?: IProcessEnv): IEnvBlock {
+    throw new Error('createEnvBlock() not supported on windows.');
+  }
+
+  public static startZygote(): void {
+    throw new Error('startZygote() not supported on windows.');
+  }
+
+  public static setIoThreadPoolSize(size: number): void {
+    throw new Error('setIoThreadPoolSize() not supported on windows.');
+  }
+
+  public static adopt(handle: IPtyHandle, opt?: IWindowsPtyForkOptions): WindowsTerminal {
+    throw new Error('adopt() not supported on windows.');
+  }
+
+  public static processMany(terms: WindowsTerminal[]): Promise<Array<IForegroundProcess | null>> {
+    return Promise.reject(new Error('processMany() not supported on windows.'));
+  }
+
+  public transfer(): IPtyHandle {
+    throw new Error('transfer() not supported on windows.');
+  }
+
+  public setMatchPatterns(patterns: Array<string | Buffer>): void {
+    throw new Error('setMatchPatterns() not supported on windows.');
+  }
+
+  public setPlainTextTap(target: number | ((text: string | Buffer) => void) | null): void {
+    throw new Error('setPlainTextTap() not supported on windows.');
+  }
+
+  public setCompressionTap(target: number | ((frame: ICompressedFrame) => void) | null, level?: number): void {
+    throw new Error('setCompressionTap() not supported on windows.');
+  }
+
+  public forward(targetFd: number): Promise<void> {
+    throw new Error('forward() not supported on windows.');
+  }
+
+  public startRecording(path: string, options?: IRecordingOptions): void {
+    throw new Error('startRecording() not supported on windows.');
+  }
+
+  public stopRecording(): void {
+    throw new Error('stopRecording() not supported on windows.');
+  }
+
+  public snapshot(offset?: number): ISnapshot {
+    throw new Error('snapshot() not supported on windows.');
+  }
+
+  public ack(bytes?: number): void {
+    throw new Error('ack() not supported on windows.');
+  }
+
+  public releaseBuffer(data: Buffer): void {
+    throw new Error('releaseBuffer() not supported on windows.');
+  }
+
+  public paste(data: Buffer | string | NodeJS.ReadableStream, options?: IPasteOptions): Promise<void> {
+    return Promise.reject(new Error('paste() not supported on windows.'));
+  }
+
   /**
    * TTY
    */
@@ -0,0 +1,258 @@
+// Benchmarks the Unix pty path: spawn latency with each spawn method, output throughput with each
+// encoding and reader, input to echo round trip, exit notification latency and the cost of idle
+// ptys. The cost of forkpty grows with the memory of the parent process, --ballast-mb allocates
+// that much memory first to show the difference. --json prints the results as a single JSON
+// object instead, for tracking regressions.
+//
+//   node test/benchmark.js [--json] [--iterations=200] [--ballast-mb=2048] [--throughput-mb=64] [--idle=1000]
+
+var fs = require('fs');
+var os = require('os');
+var pty = require('..');
+
+var isLinux = os.platform() === 'linux';
+
+function option(name, fallback) {
+  var prefix = `--${name}=`;
+  var arg = process.argv.find(arg => arg.startsWith(prefix));
+  return arg ? Number(arg.slice(prefix.length)) : fallback;
+}
+
+var json = process.argv.includes('--json');
+var iterations = option('iterations', 200);
+var ballastMb = option('ballast-mb', 0);
+var throughputMb = option('throughput-mb', 64);
+var idleCount = option('idle', 1000);
+
+function log(line) {
+  if (!json) {
+    console.log(line);
+  }
+}
+
+// Touched memory, like a large heap it has to be mapped into a forked child.
+var ballast = [];
+for (let i = 0; i < ballastMb; i++) {
+  ballast.push(Buffer.alloc(1024 * 1024, 1));
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function round(value) {
+  return Math.round(value * 1000) / 1000;
+}
+
+// Latency samples in ms
+function summarize(samples) {
+  samples.sort((a, b) => a - b);
+  return {
+    p50: round(percentile(samples, 0.5)),
+    p99: round(percentile(samples, 0.99)),
+    mean: round(samples.reduce((sum, sample) => sum + sample, 0) / samples.length)
+  };
+}
+
+function formatLatency(r) {
+  return `p50 ${r.p50.toFixed(3)} ms  p99 ${r.p99.toFixed(3)} ms  mean ${r.mean.toFixed(3)} ms`;
+}
+
+function elapsedMs(start) {
+  return Number(process.hrtime.bigint() - start) / 1e6;
+}
+
+function waitForExit(ptyProcess) {
+  return new Promise(resolve => ptyProcess.onExit(resolve));
+}
+
+function waitForOutput(ptyProcess, text) {
+  return new Promise(resolve => {
+    var buffer = '';
+    var listener = ptyProcess.onData(data => {
+      buffer += data;
+      if (buffer.includes(text)) {
+        listener.dispose();
+        resolve();
+      }
+    });
+  });
+}
+
+function nextData(ptyProcess) {
+  return new Promise(resolve => {
+    var listener = ptyProcess.onData(() => {
+      listener.dispose();
+      resolve();
+    });
+  });
+}
+
+function threadCount() {
+  if (!isLinux) {
+    return null;
+  }
+  var match = /^Threads:\s+(\d+)$/m.exec(fs.readFileSync('/proc/self/status', 'utf8'));
+  return match ? Number(match[1]) : null;
+}
+
+async function measureSpawn(spawnMethod) {
+  var samples = [];
+  for (let i = 0; i < iterations; i++) {
+    var start = process.hrtime.bigint();
+    var ptyProcess = pty.spawn('/bin/true', [], { spawnMethod });
+    samples.push(elapsedMs(start));
+    await waitForExit(ptyProcess);
+  }
+  return summarize(samples);
+}
+
+async function measureThroughput(options) {
+  var bytes = throughputMb * 1024 * 1024;
+  var start = process.hrtime.bigint();
+  var ptyProcess = pty.spawn('/bin/sh', ['-c', `head -c ${bytes} /dev/zero | tr '\\0' x`], options);
+  var received = 0;
+  ptyProcess.onData(data => {
+    // Only ASCII is written, the length of a string is its size in bytes
+    received += data.length;
+    if (options.outputBufferPoolSize) {
+      ptyProcess.releaseBuffer(data);
+    }
+  });
+  await waitForExit(ptyProcess);
+  var seconds = elapsedMs(start) / 1000;
+  if (received !== bytes) {
+    throw new Error(`Received ${received} of ${bytes} bytes`);
+  }
+  return { mbPerSecond: round(throughputMb / seconds) };
+}
+
+async function measureEcho(options) {
+  // cat echoes every byte as soon as it is read
+  var ptyProcess = pty.spawn('/bin/sh', ['-c', 'stty raw -echo; echo ready; exec cat'], options);
+  await waitForOutput(ptyProcess, 'ready');
+  var samples = [];
+  for (let i = 0; i < iterations; i++) {
+    var echo = nextData(ptyProcess);
+    var start = process.hrtime.bigint();
+    ptyProcess.write('x');
+    await echo;
+    samples.push(elapsedMs(start));
+  }
+  var exit = waitForExit(ptyProcess);
+  ptyProcess.kill('SIGKILL');
+  await exit;
+  return summarize(samples);
+}
+
+async function measureExit() {
+  var samples = [];
+  for (let i = 0; i < iterations; i++) {
+    var ptyProcess = pty.spawn('/bin/sh', ['-c', 'echo ready; exec sleep 60'], {});
+    await waitForOutput(ptyProcess, 'ready');
+    var exit = waitForExit(ptyProcess);
+    var start = process.hrtime.bigint();
+    process.kill(ptyProcess.pid, 'SIGKILL');
+    await exit;
+    samples.push(elapsedMs(start));
+  }
+  return summarize(samples);
+}
+
+async function measureIdle(count) {
+  var before = { rss: process.memoryUsage().rss, threads: threadCount() };
+  var ptys = [];
+  var error = null;
+  try {
+    for (let i = 0; i < count; i++) {
+      ptys.push(pty.spawn('/bin/cat', [], {}));
+    }
+  } catch (e) {
+    // Usually the fd limit, the ptys spawned so far are still measured
+    error = e.message;
+  }
+  // Let the children start and the exit watchers settle
+  await new Promise(resolve => setTimeout(resolve, 1000));
+  var after = { rss: process.memoryUsage().rss, threads: threadCount() };
+  var exits = ptys.map(ptyProcess => waitForExit(ptyProcess));
+  ptys.forEach(ptyProcess => ptyProcess.kill('SIGKILL'));
+  await Promise.all(exits);
+  var per1k = 1000 / Math.max(ptys.length, 1);
+  return {
+    count: ptys.length,
+    rssMbPer1k: round((after.rss - before.rss) / (1024 * 1024) * per1k),
+    threadsPer1k: before.threads === null ? null : round((after.threads - before.threads) * per1k),
+    error
+  };
+}
+
+async function main() {
+  var results = {
+    platform: os.platform(),
+    arch: os.arch(),
+    node: process.version,
+    iterations,
+    ballastMb,
+    rssMb: Math.round(process.memoryUsage().rss / 1048576),
+    spawn: {},
+    throughput: {},
+    echo: {},
+    exit: null,
+    idle: null
+  };
+
+  log(`spawn latency, ${iterations} iterations, ${ballastMb} MB ballast, rss ${results.rssMb} MB`);
+  var methods = isLinux ? ['forkpty', 'default', 'zygote'] : ['default'];
+  if (isLinux) {
+    // Not part of the measurement, the zygote is started once per process.
+    pty.startZygote();
+  }
+  for (const method of methods) {
+    results.spawn[method] = await measureSpawn(method);
+    log(`  ${method.padEnd(8)} ${formatLatency(results.spawn[method])}`);
+  }
+  if (isLinux) {
+    log(`  forkpty / default p50: ${(results.spawn.forkpty.p50 / results.spawn.default.p50).toFixed(1)}x`);
+  }
+
+  log(`output throughput, ${throughputMb} MB`);
+  var readers = {
+    'utf8': { encoding: 'utf8' },
+    'null': { encoding: null },
+    'utf8 native': { encoding: 'utf8', useNativeIo: true },
+    'null native': { encoding: null, useNativeIo: true },
+    'null pooled': { encoding: null, useNativeIo: true, outputBufferPoolSize: 4 }
+  };
+  for (const name of Object.keys(readers)) {
+    results.throughput[name] = await measureThroughput(readers[name]);
+    log(`  ${name.padEnd(12)} ${results.throughput[name].mbPerSecond.toFixed(1)} MB/s`);
+  }
+
+  log(`input to echo round trip, ${iterations} iterations`);
+  var echoReaders = {
+    'tty': {},
+    'native': { useNativeIo: true, outputFlushInterval: 0 }
+  };
+  for (const name of Object.keys(echoReaders)) {
+    results.echo[name] = await measureEcho(echoReaders[name]);
+    log(`  ${name.padEnd(8)} ${formatLatency(results.echo[name])}`);
+  }
+
+  results.exit = await measureExit();
+  log(`exit notification, ${iterations} iterations`);
+  log(`  ${formatLatency(results.exit)}`);
+
+  results.idle = await measureIdle(idleCount);
+  var idle = results.idle;
+  log(`idle ptys, ${idle.count} of ${idleCount}${idle.error ? ` (${idle.error})` : ''}`);
+  log(`  ${idle.rssMbPer1k.toFixed(1)} MB rss and ${idle.threadsPer1k === null ? 'n/a' : idle.threadsPer1k.toFixed(1)} threads per 1k`);
+
+  if (json) {
+    console.log(JSON.stringify(results, null, 2));
+  }
+}
+
+main().catch(e => {
+  console.error(e);
+  process.exit(1);
+});
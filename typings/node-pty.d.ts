@@ -17,6 +17,76 @@ declare module "@lydell/node-pty" {
    */
   export function spawn(file: string, args: string[] | string, options: IPtyForkOptions | IWindowsPtyForkOptions): IPty;
 
+  /**
+   * (EXPERIMENTAL)
+   * Like `spawn`, but the work of starting the process, including the fork, is done on a worker
+   * thread so that the event loop is never blocked by it. Resolves once the process is running.
+   * @param file The file to launch.
+   * @param args The file's arguments as argv (string[]) or in a pre-escaped CommandLine format
+   * (string). Note that the CommandLine option is only available on Windows and is expected to be
+   * escaped properly.
+   * @param options The options of the terminal.
+   */
+  export function spawnAsync(file: string, args: string[] | string, options: IPtyForkOptions | IWindowsPtyForkOptions): Promise<IPty>;
+
+  /**
+   * (EXPERIMENTAL)
+   * Spawns a process for each spec like `spawn`, but in a single native call. Specs whose `env`
+   * option is the same object, or that all use the default of `process.env`, share a single parsed
+   * copy of it. A spec that fails does not affect the others.
+   * @param specs The processes to launch.
+   * @returns The pty of each spec, or the Error that spawning it failed with, in the order of
+   * `specs`.
+   */
+  export function forkMany(specs: IForkSpec[]): (IPty | Error)[];
+
+  /**
+   * (EXPERIMENTAL)
+   * Copies, sanitizes and parses an environment once, so that it can be passed to any number of
+   * spawns with the `envBlock` option without that work being repeated for each. This is not
+   * supported on Windows.
+   * @param env The environment, `process.env` by default.
+   */
+  export function createEnvBlock(env?: { [key: string]: string | undefined }): IEnvBlock;
+
+  /**
+   * (EXPERIMENTAL)
+   * Starts the helper process used by `spawnMethod: 'zygote'` ahead of the first spawn. Without
+   * this it is started by the first such spawn. This is only supported on Linux.
+   */
+  export function startZygote(): void;
+
+  /**
+   * (EXPERIMENTAL)
+   * Sets the number of native I/O threads that ptys spawned with `useIoThread` are spread over,
+   * 1 by default. Threads are started as they are needed and keep running once started. This is
+   * not supported on Windows.
+   * @param size The maximum number of I/O threads.
+   */
+  export function setIoThreadPoolSize(size: number): void;
+
+  /**
+   * (EXPERIMENTAL)
+   * Takes over a pty handed over with `IPty.transfer`, usually on the worker thread the handle was
+   * posted to. The pty is read and its exit reported on the calling thread from then on. This is
+   * only supported on Linux.
+   * @param handle The handle returned by `IPty.transfer`.
+   * @param options How to read the pty, such as `encoding` and `useNativeIo`. Options that only
+   * apply to spawning are ignored.
+   */
+  export function adopt(handle: IPtyHandle, options?: IPtyForkOptions): IPty;
+
+  /**
+   * (EXPERIMENTAL)
+   * Queries the foreground process of every pty in a single native call, on a thread of the libuv
+   * pool so that polling many ptys does not block the event loop. This is not supported on
+   * Windows.
+   * @param ptys The ptys to query.
+   * @returns The foreground process of each pty, in the order of `ptys`, or null for ptys that have
+   * none, such as those that exited.
+   */
+  export function processMany(ptys: IPty[]): Promise<(IForegroundProcess | null)[]>;
+
   export interface IBasePtyForkOptions {
 
     /**
@@ -83,6 +153,90 @@ declare module "@lydell/node-pty" {
      */
     uid?: number;
     gid?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * Whether to read and write the pty through node-pty's native I/O loop instead of a
+     * `tty.ReadStream` (false by default). Output is drained natively and handed to JS in
+     * coalesced chunks, see `outputFlushInterval` and `outputFlushSize`, which greatly reduces the
+     * number of `data` events on chatty programs.
+     */
+    useNativeIo?: boolean;
+
+    /**
+     * (EXPERIMENTAL)
+     * Like `useNativeIo`, but the pty is read, written and flow controlled on a native I/O thread
+     * shared by all such ptys instead of the Node event loop, so that it keeps being served while
+     * JS is busy or collecting garbage. Output of all ptys read in one wakeup of the thread is
+     * handed to JS together. `outputBufferPoolSize` is ignored. See `setIoThreadPoolSize`.
+     */
+    useIoThread?: boolean;
+
+    /**
+     * (EXPERIMENTAL)
+     * The number of bytes of the latest output to keep in native memory for `IPty.snapshot`, for
+     * example to replay to a client that reconnects. The memory grows with the output up to this
+     * size and does not take part in garbage collection. Implies `useNativeIo`. None by default.
+     */
+    scrollbackSize?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * When `useNativeIo` is true, the maximum time in milliseconds output is held back to be
+     * coalesced with more output. 0 hands output over as soon as it was read. Default is 5.
+     */
+    outputFlushInterval?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * When `useNativeIo` is true, the amount of buffered output in bytes that is handed over
+     * without waiting for `outputFlushInterval`. Default is 65536.
+     */
+    outputFlushSize?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * When `useNativeIo` is true and `encoding` is null, the number of reusable `outputFlushSize`
+     * byte buffers output is read into (none by default). Output read into them is emitted as
+     * Buffer views without any copy and the buffer stays leased until it is handed back with
+     * `IPty.releaseBuffer`. While all buffers are leased output is copied into new Buffers instead.
+     */
+    outputBufferPoolSize?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * When `useNativeIo` is true, the number of bytes of output that may be emitted without being
+     * acknowledged with `IPty.ack` before node-pty stops reading the pty. The program writing to
+     * it then blocks once the kernel's buffer is full, which bounds the memory a fast producer can
+     * take up behind a slow consumer. 0, the default, disables this.
+     */
+    flowControlHighWatermark?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * When reading stopped at `flowControlHighWatermark`, the number of unacknowledged bytes at or
+     * below which it resumes. Default is half of `flowControlHighWatermark`.
+     */
+    flowControlLowWatermark?: number;
+
+    /**
+     * (EXPERIMENTAL)
+     * How the process is started. On Linux 'default' starts it with a vfork-style clone(2) that
+     * does not copy the address space of the Node process, so its cost does not depend on the
+     * size of the Node heap. 'forkpty' uses the previous forkpty(3), which copies the page tables
+     * of the whole process. 'zygote' has a small helper process, started once and shared by all
+     * ptys, fork it instead, which also takes the work of the fork off the Node process. The exit
+     * code of a child spawned by the zygote is only known while the zygote is running. 'forkpty'
+     * and 'zygote' are only supported on Linux. Default is 'default'.
+     */
+    spawnMethod?: 'default' | 'forkpty' | 'zygote';
+
+    /**
+     * (EXPERIMENTAL)
+     * An environment created with `createEnvBlock` to spawn with in place of `env`, which is then
+     * ignored. PWD and TERM are still set from `cwd` and `name`.
+     */
+    envBlock?: IEnvBlock;
   }
 
   export interface IWindowsPtyForkOptions extends IBasePtyForkOptions {
@@ -93,6 +247,22 @@ declare module "@lydell/node-pty" {
     conptyInheritCursor?: boolean;
   }
 
+  /**
+   * An environment created by `createEnvBlock`.
+   */
+  export interface IEnvBlock {
+    readonly env: { [key: string]: string | undefined };
+  }
+
+  /**
+   * One process to launch with `forkMany`, the arguments of `spawn`.
+   */
+  export interface IForkSpec {
+    file: string;
+    args: string[] | string;
+    options: IPtyForkOptions | IWindowsPtyForkOptions;
+  }
+
   /**
    * An interface representing a pseudoterminal.
    */
@@ -137,6 +307,38 @@ declare module "@lydell/node-pty" {
      */
     readonly onExit: IEvent<{ exitCode: number, signal?: number }>;
 
+    /**
+     * (EXPERIMENTAL)
+     * Like `onData`, with the byte offset of the data in all output of the pty, counting from 0.
+     * Offsets only grow, a client that reconnects can ask for the output after the last byte it
+     * got, see `snapshot`. With `useNativeIo`, `useIoThread` or `scrollbackSize` they are counted
+     * natively before decoding, a character split between two chunks is emitted with the later
+     * one. Otherwise only raw output (`encoding: null`) can be counted and this does not fire for
+     * decoded output, which includes all output on Windows.
+     * @returns an `IDisposable` to stop listening.
+     */
+    readonly onOutput: IEvent<{ data: string | Buffer, offset: number }>;
+
+    /**
+     * (EXPERIMENTAL)
+     * Adds an event listener for when the foreground process group of the pty changes, such as when
+     * the shell runs a program or takes over again once it exited. This replaces polling `process`:
+     * while there are listeners, the group is checked whenever there is output, which a new
+     * foreground process nearly always causes, and every 250ms for changes without output. Only
+     * changes after the spawn are reported. This never fires on Windows.
+     * @returns an `IDisposable` to stop listening.
+     */
+    readonly onProcessChange: IEvent<{ pgrp: number, process: string }>;
+
+    /**
+     * (EXPERIMENTAL)
+     * Adds an event listener for when output matches a pattern given to `setMatchPatterns`. It
+     * fires with the index of the pattern and the byte offset of its first byte in all output, see
+     * `onOutput`, once the output it ends in was emitted.
+     * @returns an `IDisposable` to stop listening.
+     */
+    readonly onMatch: IEvent<{ pattern: number, offset: number }>;
+
     /**
      * Resizes the dimensions of the pty.
      * @param columns The number of columns to use.
@@ -166,6 +368,141 @@ declare module "@lydell/node-pty" {
      */
     kill(signal?: string): void;
 
+    /**
+     * (EXPERIMENTAL)
+     * Hands a Buffer emitted by a `data` event back to the output buffer pool so that it can be
+     * reused, see `IPtyForkOptions.outputBufferPoolSize`. The Buffer must not be used afterwards.
+     * Buffers that were not taken from the pool are ignored. This is not supported on Windows.
+     * @param data The Buffer to release.
+     */
+    releaseBuffer(data: Buffer): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Acknowledges that output was consumed, see `IPtyForkOptions.flowControlHighWatermark`. This
+     * is not supported on Windows.
+     * @param bytes The number of bytes consumed, as counted by `Buffer.byteLength` for string
+     * data. Without it all output emitted so far is acknowledged.
+     */
+    ack(bytes?: number): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Writes a large amount of input, like a paste, in chunks. Each chunk is written once the
+     * program read all input written before it, so that the kernel's input buffer never overflows.
+     * In canonical mode the kernel holds at most 4095 bytes of a single line and silently drops
+     * the rest of a longer line, no matter how the input is paced. This is not supported on
+     * Windows.
+     * @param data The input, a stream is read as it becomes readable.
+     * @param options Bracketed paste and progress reporting.
+     * @returns A promise that resolves once all input was written and rejects when the pty exits
+     * first.
+     */
+    paste(data: Buffer | string | NodeJS.ReadableStream, options?: IPasteOptions): Promise<void>;
+
+    /**
+     * (EXPERIMENTAL)
+     * Hands the pty over to be taken over with `adopt`, usually by a `worker_threads` Worker the
+     * returned handle is posted to. This lets ptys be spread over the threads of one process. This
+     * IPty emits no more events and must not be used afterwards, an exit in between is reported
+     * to the adopting thread. A handle that is never adopted, such as one posted to a worker that
+     * died, keeps a little bookkeeping alive until the process exits. This is only supported on
+     * Linux.
+     * @throws When the process already exited.
+     */
+    transfer(): IPtyHandle;
+
+    /**
+     * (EXPERIMENTAL)
+     * Returns the output kept with `IPtyForkOptions.scrollbackSize`. This is not supported on
+     * Windows.
+     * @param offset Only return output from this byte offset on, counting all output of the pty
+     * from 0. Without it, all output kept is returned.
+     * @returns The output, a string unless `encoding` is null, and the byte offset it starts at.
+     * That is later than `offset` when older output was dropped already.
+     * @throws When `scrollbackSize` is not set.
+     */
+    snapshot(offset?: number): ISnapshot;
+
+    /**
+     * (EXPERIMENTAL)
+     * Scans all further output natively for byte patterns, such as prompts or OSC 133 shell
+     * integration markers, and fires `onMatch` for every occurrence, including those split across
+     * chunks and overlapping ones. All patterns are searched for in a single pass over the output,
+     * so JS does not need to look at the output to find them. This requires `useNativeIo`,
+     * `useIoThread` or `scrollbackSize` and is not supported on Windows.
+     * @param patterns The patterns, strings are matched as UTF-8. They replace the patterns given
+     * before, an empty array stops scanning.
+     */
+    setMatchPatterns(patterns: (string | Buffer)[]): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Keeps a plain text copy of all further output, for logging or indexing. Escape sequences
+     * (CSI, OSC, DCS, SOS, PM, APC and the short ESC ones) and all control characters but tabs and
+     * line feeds are stripped natively, also when they span chunks. This requires `useNativeIo`,
+     * `useIoThread` or `scrollbackSize` and is not supported on Windows.
+     * @param target Either a function called with the text of each chunk after it was emitted, a
+     * string unless `encoding` is null, or an fd the text is written to off the event loop, such
+     * as that of a log file. A pipe or socket is made non-blocking. Writing to an fd stops at the
+     * first error or once more than 4 MiB wait to be written, the fd is not closed. Null stops the
+     * tap.
+     */
+    setPlainTextTap(target: number | ((text: string | Buffer) => void) | null): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Compresses all further output natively with deflate, for forwarding or archiving it. All
+     * output goes through one deflate stream, so output repeated from earlier chunks, like redraws
+     * and escape sequences, compresses as well as output repeated within one. This requires
+     * `useNativeIo`, `useIoThread` or `scrollbackSize` and is not supported on Windows.
+     * @param target Either a function called with the frame of each chunk after the chunk was
+     * emitted, or an fd a gzip stream of the output is written to off the event loop, such as
+     * that of an archive file. Frames are raw deflate data, sync flushed so that a single inflate
+     * stream fed all frames in order, such as `zlib.createInflateRaw()`, decompresses each
+     * completely. The gzip stream is ended when the tap stops. A pipe or socket is made
+     * non-blocking. Writing stops at the first error or once more than 4 MiB wait to be written,
+     * which leaves a stream that is cut short but intact up to there. The fd is not closed. Null
+     * stops the tap.
+     * @param level The zlib compression level, from 0 to 9. The default is zlib's default, 6.
+     */
+    setCompressionTap(target: number | ((frame: ICompressedFrame) => void) | null, level?: number): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Records the session to a file natively, without the output passing through JS. Output, and
+     * optionally input and resizes, are written off the event loop with the time since the
+     * recording started, in batches once 64 KiB are buffered or a second after the first event.
+     * Recording stops with `stopRecording`, when the pty closes, or at the first failed write.
+     * This requires `useNativeIo`, `useIoThread` or `scrollbackSize` and is not supported on
+     * Windows.
+     * @param path The file to create, it is replaced if it exists. Any recording so far is stopped.
+     * @param options The format and whether to record input.
+     * @throws When the file can not be created.
+     */
+    startRecording(path: string, options?: IRecordingOptions): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Writes what is buffered and stops recording, see `startRecording`.
+     */
+    stopRecording(): void;
+
+    /**
+     * (EXPERIMENTAL)
+     * Relays between the pty and another fd natively on an I/O thread, for sessions that are only
+     * passed on, such as to a socket: output is written to the fd and what is read from it is
+     * written to the pty, without passing through JS. `onData` and the other output events no
+     * longer fire, `write` still works. This requires `useNativeIo`, `useIoThread` or
+     * `scrollbackSize` and is not supported on Windows.
+     * @param targetFd A pollable fd, such as that of a socket or pipe. It is made non-blocking and
+     * is not closed.
+     * @returns A promise resolving once either side closed and what was read from it was passed
+     * on, or rejecting with the error that ended the relay. The terminal is closed then, which
+     * hangs up the process if it is still running.
+     */
+    forward(targetFd: number): Promise<void>;
+
     /**
      * Pauses the pty for customizable flow control.
      */
@@ -177,6 +514,103 @@ declare module "@lydell/node-pty" {
     resume(): void;
   }
 
+  /**
+   * The foreground process group of a pty.
+   */
+  export interface IForegroundProcess {
+    /**
+     * The id of the process group, which is also the pid of its leader.
+     */
+    readonly pgrp: number;
+
+    /**
+     * The name of the process, like `IPty.process`.
+     */
+    readonly name: string;
+
+    /**
+     * The arguments of the leader, including argv[0]. They may be empty when they can not be read,
+     * such as for processes of other users on macOS.
+     */
+    readonly argv: string[];
+  }
+
+  /**
+   * The compressed output of one chunk, see `IPty.setCompressionTap`.
+   */
+  export interface ICompressedFrame {
+    /**
+     * The raw deflate data of the chunk.
+     */
+    readonly data: Buffer;
+
+    /**
+     * The byte offset of the chunk in all output, see `IPty.onOutput`.
+     */
+    readonly offset: number;
+
+    /**
+     * The length of the chunk before compression.
+     */
+    readonly length: number;
+  }
+
+  export interface IRecordingOptions {
+    /**
+     * `asciicast` (the default) writes asciicast v2, which assumes UTF-8 output. `raw` writes
+     * "NPTYREC1" followed by a record per event: its type as one byte (`o`utput, `i`nput or
+     * `r`esize), the microseconds since the start as a 64-bit and the length of the data as a
+     * 32-bit little endian integer, then the data, for resizes the columns and rows as 16-bit
+     * little endian integers. The initial size is recorded as a resize.
+     */
+    format?: 'asciicast' | 'raw';
+
+    /**
+     * Whether to record what is written to the pty, false by default.
+     */
+    input?: boolean;
+  }
+
+  /**
+   * A pty handed over with `IPty.transfer`. It is a plain object that can be posted to a worker.
+   */
+  export interface IPtyHandle {
+    readonly fd: number;
+    readonly pid: number;
+    readonly pty: string;
+    readonly file: string;
+    readonly name: string;
+    readonly cols: number;
+    readonly rows: number;
+  }
+
+  export interface ISnapshot {
+    /**
+     * The byte offset of the first byte of `data` in all output of the pty.
+     */
+    offset: number;
+    data: string | Buffer;
+  }
+
+  export interface IPasteOptions {
+    /**
+     * Whether to wrap the input in the bracketed paste sequences `\x1b[200~` and `\x1b[201~`.
+     * Only enable it when the program turned on bracketed paste mode (`\x1b[?2004h`).
+     */
+    bracketed?: boolean;
+
+    /**
+     * The maximum number of bytes written at once, defaults to 2048.
+     */
+    chunkSize?: number;
+
+    /**
+     * Called after each chunk with the number of bytes written so far and the total size, which is
+     * undefined for streams.
+     */
+    onProgress?: (bytesWritten: number, totalBytes: number | undefined) => void;
+  }
+
   /**
    * An object that can be disposed via a dispose function.
    */